@@ -1,11 +1,22 @@
 #include <ctype.h>
 #include <dirent.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#define MAX_LINE_LENGTH 1024
-#define MAX_FILENAME_LENGTH 256
+#define MAX_FILENAME_LENGTH 512
+#define MAX_VARIANT_FLAGS 4
+#define MAX_FLAG_LENGTH 32
+#define VARIANTS_TAG "@variants:"
+#define EXPORT_TAG "@export"
+
+typedef struct ShaderVariants {
+    char flags[MAX_VARIANT_FLAGS][MAX_FLAG_LENGTH];
+    unsigned requires[MAX_VARIANT_FLAGS]; // mask of flags each flag depends on
+    int count;
+} ShaderVariants;
 
 // Helper function to convert string to uppercase
 char *strupr(char *s) {
@@ -17,52 +28,327 @@ char *strupr(char *s) {
     return s;
 }
 
-void write_shader_to_header(FILE *header_file, char *filename) {
-    FILE *shader_file = fopen(filename, "r");
-    if (!shader_file) {
+// Read whole file into a NUL terminated buffer, no limit on line length
+char *read_file(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
         perror("Failed to open shader file");
-        return;
+        return NULL;
     }
 
-    char *base_name = strrchr(filename, '/');
-    if (base_name) {
-        base_name++;  // escape '/'
-    } else {
-        base_name = filename;
+    size_t size = 0, capacity = 4096;
+    char *buf = malloc(capacity);
+    size_t n;
+    while (buf && (n = fread(buf + size, 1, capacity - size - 1, fp)) > 0) {
+        size += n;
+        if (capacity - size - 1 == 0) {
+            char *grown = realloc(buf, capacity * 2);
+            if (!grown) free(buf);
+            buf = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(fp);
+
+    if (!buf) {
+        fprintf(stderr, "Failed to alloc memory for %s\n", filename);
+        return NULL;
+    }
+    buf[size] = '\0';
+    return buf;
+}
+
+// Length of the identifier at p
+size_t identifier_length(const char *p) {
+    size_t len = 0;
+    while (isalnum((unsigned char)p[len]) || p[len] == '_') len++;
+    return len;
+}
+
+/*
+ * Parse `// @variants: FLAG FLAG:DEP ...', each flag is a `#define' switched on or off
+ * per variant, `:DEP' names an earlier flag it is only meaningful with.
+ */
+int parse_variants(const char *src, const char *filename, ShaderVariants *variants) {
+    variants->count = 0;
+    const char *tag = strstr(src, VARIANTS_TAG);
+    if (!tag) return 0;
+
+    const char *p = tag + strlen(VARIANTS_TAG);
+    while (*p && *p != '\n') {
+        while (*p == ' ' || *p == '\t') p++;
+        size_t len = identifier_length(p);
+        if (len == 0) break;
+        if (variants->count == MAX_VARIANT_FLAGS || len >= MAX_FLAG_LENGTH) {
+            fprintf(stderr, "%s: too many or too long variant flags, at most %d\n", filename, MAX_VARIANT_FLAGS);
+            return -1;
+        }
+        int flag = variants->count++;
+        snprintf(variants->flags[flag], MAX_FLAG_LENGTH, "%.*s", (int)len, p);
+        variants->requires[flag] = 0;
+        p += len;
+
+        while (*p == ':') {
+            p++;
+            len = identifier_length(p);
+            int dep = 0;
+            while (dep < flag && (strlen(variants->flags[dep]) != len || strncmp(variants->flags[dep], p, len))) dep++;
+            if (len == 0 || dep == flag) {
+                fprintf(stderr, "%s: variant flag `%s' depends on `%.*s', which isn't an earlier flag\n", filename, variants->flags[flag], (int)len, p);
+                return -1;
+            }
+            variants->requires[flag] |= 1u << dep;
+            p += len;
+        }
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    if (*p && *p != '\n') {
+        fprintf(stderr, "%s: invalid character in variant flags: `%c'\n", filename, *p);
+        return -1;
+    }
+    return 0;
+}
+
+// A flag set without the flags it depends on is a variant nothing selects
+int is_variant_reachable(const ShaderVariants *variants, unsigned mask) {
+    for (int i = 0; i < variants->count; ++i) {
+        if ((mask & (1u << i)) && (mask & variants->requires[i]) != variants->requires[i]) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Source of one variant, `#define' of enabled flags injected right after `#version',
+ * followed by `#line' so compile errors point at lines of the original file.
+ */
+char *build_variant(const char *src, const ShaderVariants *variants, unsigned mask) {
+    const char *body = src;
+    int body_line = 1;
+    if (!strncmp(src, "#version", 8)) {
+        const char *eol = strchr(src, '\n');
+        body = eol ? eol + 1 : src + strlen(src);
+        body_line = 2;
+    }
+
+    size_t size = strlen(src) + 2 + sizeof("#line 2\n");
+    for (int i = 0; i < variants->count; ++i) size += strlen(variants->flags[i]) + sizeof("#define \n");
+    char *out = malloc(size);
+    if (!out) return NULL;
+
+    int len = snprintf(out, size, "%.*s", (int)(body - src), src);
+    if (len && out[len - 1] != '\n') len += snprintf(out + len, size - len, "\n");
+    for (int i = 0; i < variants->count; ++i) {
+        if (mask & (1u << i)) len += snprintf(out + len, size - len, "#define %s\n", variants->flags[i]);
+    }
+    if (variants->count) len += snprintf(out + len, size - len, "#line %d\n", body_line);
+    snprintf(out + len, size - len, "%s", body);
+    return out;
+}
+
+/*
+ * `#define NAME VALUE // @export' lines become NAME_SHADER_<NAME> in the header,
+ * so C code shares limits & thresholds with the shader instead of a copy.
+ */
+int write_exports(FILE *header_file, const char *src, const char *filename, const char *name) {
+    const char *eol;
+    for (const char *line = src; *line; line = *eol ? eol + 1 : eol) {
+        eol = line + strcspn(line, "\n");
+        const char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "#define", 7)) continue;
+        const char *comment = strstr(p, "//");
+        if (!comment || comment > eol || strncmp(comment + 2 + strspn(comment + 2, " \t"), EXPORT_TAG, strlen(EXPORT_TAG))) continue;
+
+        p += 7;
+        while (*p == ' ' || *p == '\t') p++;
+        size_t len = identifier_length(p);
+        const char *value = p + len;
+        while (*value == ' ' || *value == '\t') value++;
+        const char *end = comment;
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t')) end--;
+        if (len == 0 || end == value) {
+            fprintf(stderr, "%s: exported `#define' needs a name and a value\n", filename);
+            return -1;
+        }
+        fprintf(header_file, "#define %s_SHADER_%.*s %.*s\n", name, (int)len, p, (int)(end - value), value);
     }
-    char *dot = strrchr(base_name, '.');
+    return 0;
+}
+
+// FNV-1a, identifies a variant in logs & caches
+uint32_t hash_source(const char *src) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)src; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Compile variant offline with glslang, returns 0 when valid or glslang isn't installed
+int validate_variant(const char *validator, const char *src, const char *filename, const char *variant) {
+    if (!validator) return 0;
+
+    char path[] = "/tmp/zoomify-shader-XXXXXX.frag";
+    int fd = mkstemps(path, 5);
+    if (fd < 0) {
+        perror("Failed to create temporary shader file");
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (!fp) {
+        perror("Failed to open temporary shader file");
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    fputs(src, fp);
+    fclose(fp);
+
+    char command[MAX_FILENAME_LENGTH * 2];
+    snprintf(command, sizeof(command), "\"%s\" -S frag \"%s\" > /dev/null", validator, path);
+    int ret = system(command);
+    if (ret) {
+        // rerun to show errors against the file name of the variant
+        snprintf(command, sizeof(command), "\"%s\" -S frag \"%s\" | sed 's|%s|%s [%s]|g'", validator, path, path, filename, variant);
+        if (system(command) == -1) perror("Failed to run glslang");
+        fprintf(stderr, "%s: variant `%s' failed to compile\n", filename, variant);
+    }
+    unlink(path);
+    return ret ? -1 : 0;
+}
+
+void write_source(FILE *header_file, const char *src) {
+    fputc('\"', header_file);
+    for (const char *p = src; *p; p++) {
+        if (*p == '\\') {
+            fputs("\\\\", header_file);  // escape `''
+        } else if (*p == '\"') {
+            fputs("\\\"", header_file);  // escape `"'
+        } else if (*p == '\n') {
+            if (!p[1]) {
+                fputs("\\n\"", header_file);
+                return;
+            }
+            fputs("\\n\" \\\n\"", header_file);  // one string literal per line
+        } else if (*p != '\r') {
+            fputc(*p, header_file);
+        }
+    }
+    fputc('\"', header_file);
+}
+
+/*
+ * Without variants a shader becomes NAME_SHADER_SRC & NAME_SHADER_HASH as before.
+ * With n variant flags it becomes 2^n sources indexed by a bit mask of NAME_SHADER_<FLAG>:
+ * NAME_SHADER_SRC_<mask>, NAME_SHADER_HASH_<mask> and NAME_SHADER_SRCS / NAME_SHADER_HASHES
+ * initializers, so only the variant the current mode needs has to be compiled. Masks with
+ * a flag lacking its dependency are neither generated nor validated, NULL & 0 in the tables.
+ */
+int write_shader_to_header(FILE *header_file, char *filename, const char *validator) {
+    char *src = read_file(filename);
+    if (!src) return -1;
+
+    ShaderVariants variants;
+    if (parse_variants(src, filename, &variants)) {
+        free(src);
+        return -1;
+    }
+
+    char name[MAX_FILENAME_LENGTH];
+    char *base_name = strrchr(filename, '/');
+    snprintf(name, sizeof(name), "%s", base_name ? base_name + 1 : filename);
+    char *dot = strrchr(name, '.');
     if (dot) {
         *dot = '\0';  // remove extension
     }
+    strupr(name);
+
+    int ret = write_exports(header_file, src, filename, name);
+    unsigned variant_count = 1u << variants.count;
 
-    fprintf(header_file, "#define %s_SHADER_SRC \\\n", strupr(base_name));
+    if (variants.count) {
+        fprintf(header_file, "#define %s_SHADER_VARIANT_COUNT %u\n", name, variant_count);
+        for (int i = 0; i < variants.count; ++i) {
+            fprintf(header_file, "#define %s_SHADER_%s (1 << %d)\n", name, variants.flags[i], i);
+        }
+    }
 
-    char line[MAX_LINE_LENGTH];
-    while (fgets(line, sizeof(line), shader_file)) {
-        fputc('\"', header_file);
-        for (char *p = line; *p; p++) {
-            if (*p == '\\') {
-                fputs("\\\\", header_file);  // escape `''
-            } else if (*p == '\"') {
-                fputs("\\\"", header_file);  // escape `"'
-            } else if (*p == '\n') {
-                fputs("\\n\" \\\n", header_file);  // handle `\n'
-                break;
+    for (unsigned mask = 0; mask < variant_count && !ret; ++mask) {
+        if (!is_variant_reachable(&variants, mask)) continue;
+        char *variant = build_variant(src, &variants, mask);
+        if (!variant) {
+            fprintf(stderr, "Failed to alloc memory for %s\n", filename);
+            ret = -1;
+            break;
+        }
+
+        char label[MAX_FLAG_LENGTH * MAX_VARIANT_FLAGS + 8] = "base";
+        for (int i = 0, len = 0; i < variants.count; ++i) {
+            if (mask & (1u << i)) len += snprintf(label + len, sizeof(label) - len, "%s%s", len ? " " : "", variants.flags[i]);
+        }
+        ret = validate_variant(validator, variant, filename, label);
+
+        uint32_t hash = hash_source(variant);
+        if (variants.count) {
+            fprintf(header_file, "#define %s_SHADER_HASH_%u 0x%08xu /* %s */\n", name, mask, hash, label);
+            fprintf(header_file, "#define %s_SHADER_SRC_%u \\\n", name, mask);
+        } else {
+            fprintf(header_file, "#define %s_SHADER_HASH 0x%08xu\n", name, hash);
+            fprintf(header_file, "#define %s_SHADER_SRC \\\n", name);
+        }
+        write_source(header_file, variant);
+        fputs("\n\n", header_file);
+        free(variant);
+    }
+
+    if (variants.count && !ret) {
+        fprintf(header_file, "#define %s_SHADER_SRCS {", name);
+        for (unsigned mask = 0; mask < variant_count; ++mask) {
+            if (is_variant_reachable(&variants, mask)) {
+                fprintf(header_file, "%s%s_SHADER_SRC_%u", mask ? ", " : "", name, mask);
             } else {
-                fputc(*p, header_file);
+                fprintf(header_file, "%sNULL", mask ? ", " : "");
             }
         }
+        fprintf(header_file, "}\n#define %s_SHADER_HASHES {", name);
+        for (unsigned mask = 0; mask < variant_count; ++mask) {
+            if (is_variant_reachable(&variants, mask)) {
+                fprintf(header_file, "%s%s_SHADER_HASH_%u", mask ? ", " : "", name, mask);
+            } else {
+                fprintf(header_file, "%s0", mask ? ", " : "");
+            }
+        }
+        fputs("}\n\n", header_file);
     }
 
-    fclose(shader_file);
-    fputs("\n", header_file);
+    free(src);
+    return ret;
+}
+
+// glslangValidator from $GLSLANG_VALIDATOR or PATH, NULL when not installed
+const char *find_validator(void) {
+    const char *validator = getenv("GLSLANG_VALIDATOR");
+    if (validator && !*validator) return NULL;  // empty value skips validation
+    if (!validator) validator = "glslangValidator";
+
+    char command[MAX_FILENAME_LENGTH];
+    snprintf(command, sizeof(command), "command -v \"%s\" > /dev/null 2>&1", validator);
+    if (system(command)) {
+        printf("%s not found, skipping offline shader validation\n", validator);
+        return NULL;
+    }
+    return validator;
 }
 
 int main() {
     const char *input_dir = "resources";
     const char *output_file = "include/shaders.h";
+    const char *temp_file = "include/shaders.h.tmp";
+    const char *validator = find_validator();
 
-    FILE *header_file = fopen(output_file, "w");
+    // write next to the old header & rename, a failed build keeps the last good one
+    FILE *header_file = fopen(temp_file, "w");
     if (!header_file) {
         perror("Failed to create header file");
         return EXIT_FAILURE;
@@ -76,15 +362,17 @@ int main() {
     if (!dir) {
         perror("Failed to open resources directory");
         fclose(header_file);
+        unlink(temp_file);
         return EXIT_FAILURE;
     }
 
+    int failed = 0;
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_type == DT_REG && strstr(entry->d_name, ".glsl")) {
             char filepath[MAX_FILENAME_LENGTH];
             snprintf(filepath, sizeof(filepath), "%s/%s", input_dir, entry->d_name);
-            write_shader_to_header(header_file, filepath);
+            failed |= write_shader_to_header(header_file, filepath, validator) != 0;
         }
     }
 
@@ -92,6 +380,12 @@ int main() {
     fprintf(header_file, "#endif // SHADERS_H\n");
     fclose(header_file);
 
+    if (failed || rename(temp_file, output_file)) {
+        if (!failed) perror("Failed to rename header file");
+        unlink(temp_file);
+        return EXIT_FAILURE;
+    }
+
     printf("Header file %s generated successfully.\n", output_file);
     return EXIT_SUCCESS;
 }
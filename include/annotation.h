@@ -0,0 +1,45 @@
+#ifndef ANNOTATION_H
+#define ANNOTATION_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum AnnotationTool {
+    ANNOTATION_TOOL_NONE = 0,
+    ANNOTATION_TOOL_PEN,
+    ANNOTATION_TOOL_ARROW,
+    ANNOTATION_TOOL_RECTANGLE,
+    ANNOTATION_TOOL_ERASER,
+    ANNOTATION_TOOL_COUNT,
+} AnnotationTool;
+
+/*
+ * Strokes are stored in world coordinates, so they stick to the screenshot
+ * while panning & zooming. Committed strokes are rasterized into a cached
+ * layer texture larger than the screen, at a quantized zoom level, and blitted
+ * with the camera transform. It's only redrawn when the zoom level changes,
+ * the view leaves the cached area or a stroke gets removed; new strokes are
+ * appended to it incrementally.
+ */
+int initAnnotationLayer(int width, int height);
+void unloadAnnotationLayer(void);
+
+void beginAnnotationStroke(AnnotationTool tool, Vector2 worldPos, float thick, Color color);
+void extendAnnotationStroke(Vector2 worldPos, float minDistance);
+void endAnnotationStroke(void);
+
+size_t eraseAnnotationStrokes(Vector2 worldPos, float radius);
+bool undoAnnotationStroke(void);
+void clearAnnotationLayer(void);
+
+/* must be called outside of BeginDrawing/EndDrawing */
+void updateAnnotationLayer(Camera2D camera);
+/* draw cached layer and the stroke in progress, in screen space */
+void drawAnnotationLayer(Camera2D camera);
+
+size_t getAnnotationStrokeCount(void);
+size_t getAnnotationVertexCount(void);
+const char *getAnnotationToolName(AnnotationTool tool);
+
+#endif
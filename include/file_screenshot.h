@@ -0,0 +1,9 @@
+#ifndef FILE_SCREENSHOT_H
+#define FILE_SCREENSHOT_H
+
+#include "screenshot.h"
+
+extern const ScreenshotBackend fileScreenshotBackend;
+extern const ScreenshotBackend syntheticScreenshotBackend;
+
+#endif
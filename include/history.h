@@ -0,0 +1,37 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "screenshot.h"
+
+typedef struct HistoryBand {
+    size_t screen; /* index into images */
+    int y;         /* first row */
+    int height;
+} HistoryBand;
+
+/*
+ * Ring of the last captures under $XDG_CACHE_HOME/zoomify, one file per slot
+ * holding geometry and independently deflated row bands, so a snapshot can be
+ * restored a band at a time straight out of a read only mapping.
+ */
+int initHistory(void);
+void unloadHistory(void);
+
+/* pixels are copied, compression & writing happen on a worker thread */
+int saveHistorySnapshot(const Image *images, const ScreenshotContext *geometry, size_t count);
+size_t getHistoryCount(void);
+/* position of displayed snapshot, 0 is newest, -1 while it's not saved yet */
+int getHistoryPosition(void);
+
+/* map snapshot at position and fill geometry (data is left NULL), returns screen count or -1 */
+int beginHistoryRestore(int position, ScreenshotContext *geometry, size_t capacity);
+/* decompress next band into its rows of images, false once restore is done or failed */
+bool nextHistoryBand(Image *images, size_t count, HistoryBand *band);
+void cancelHistoryRestore(void);
+bool isHistoryRestoring(void);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef INSPECTOR_H
+#define INSPECTOR_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct InspectorStats {
+    Color average;
+    float luminance; /* Rec. 709 luma of average color, 0 ~ 255 */
+    size_t pixelCount;
+} InspectorStats;
+
+typedef enum InspectorState {
+    INSPECTOR_IDLE,     /* no tables, none being built */
+    INSPECTOR_BUILDING,
+    INSPECTOR_READY,
+    INSPECTOR_FAILED,   /* out of memory or worker didn't start, no region stats */
+} InspectorState;
+
+/*
+ * Build summed-area tables for RGBA8 images on a worker thread, image data
+ * must stay alive until releaseInspectorTables is called. Region statistics
+ * are O(1) once tables are ready, pixel lookup works right away.
+ */
+int startInspectorTables(const Image *images, size_t count);
+bool isInspectorReady(void);
+InspectorState getInspectorState(void);
+void releaseInspectorTables(void);
+
+bool getInspectorPixel(size_t idx, int x, int y, Color *color);
+/* region in pixel coordinates of image idx, clipped to image bounds */
+bool getInspectorRegionStats(size_t idx, Rectangle region, InspectorStats *stats);
+
+#endif
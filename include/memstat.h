@@ -0,0 +1,33 @@
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stddef.h>
+
+/* where bytes of the capture to texture pipeline live */
+typedef enum MemStage {
+    MEM_STAGE_CAPTURE = 0, /* backend side buffers, e.g. XImage */
+    MEM_STAGE_CONTEXT,     /* RGBA / PNG data in ScreenshotContext */
+    MEM_STAGE_BAND,        /* row bands in flight while streaming */
+    MEM_STAGE_IMAGE,       /* decoded Image kept on CPU side */
+    MEM_STAGE_TEXTURE,     /* GPU textures */
+    MEM_STAGE_INSPECTOR,   /* summed-area tables */
+    MEM_STAGE_COUNT,
+} MemStage;
+
+typedef struct MemStageStats {
+    size_t current;
+    size_t peak;
+} MemStageStats;
+
+/* thread safe, backends and workers account from any thread */
+void addMemStat(MemStage stage, size_t bytes);
+void subMemStat(MemStage stage, size_t bytes);
+MemStageStats getMemStat(MemStage stage);
+/* sum of all stages */
+MemStageStats getMemStatTotal(void);
+const char *getMemStageName(MemStage stage);
+/* peak resident set size of the process in bytes, 0 if unknown */
+size_t getPeakRSS(void);
+void logMemStats(const char *when);
+
+#endif
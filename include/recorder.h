@@ -0,0 +1,31 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct RecorderStats {
+    size_t framesCaptured;   /* frames handed over to encoder */
+    size_t framesWritten;    /* frames written by encoder */
+    size_t droppedReadback;  /* pixel buffers mostly waiting for GPU, or readback failed */
+    size_t droppedEncoder;   /* pixel buffers mostly held by encoder, or discarded after a write error */
+    size_t writeErrors;      /* failed writes, the first one stops recording */
+    double avgLatencyMs;     /* readback issue to map */
+    double maxLatencyMs;
+} RecorderStats;
+
+/*
+ * Record presented frames, read back asynchronously through a ring of pixel
+ * buffer objects guarded by fences, so glReadPixels never stalls the render
+ * loop. An encoder thread converts straight from the mapped buffers, which
+ * stay mapped until it's done, and writes a Y4M stream when path ends with
+ * `.y4m', otherwise a QOI image sequence into directory path.
+ */
+int startRecording(const char *path, int width, int height, int fps);
+/* call after the frame is drawn, before EndDrawing, stops recording once a write failed */
+void captureRecordingFrame(void);
+void stopRecording(void);
+bool isRecording(void);
+RecorderStats getRecorderStats(void);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SCREENSHOT_MAX_COUNT 16
+#define SCREENSHOT_BAND_HEIGHT 64 /* rows per band when streaming */
+
+typedef enum ScreenshotFormat {
+    SCREENSHOT_FORMAT_PNG = 0, /* encoded png file */
+    SCREENSHOT_FORMAT_RGBA,    /* raw RGBA8, width * height * 4 bytes */
+} ScreenshotFormat;
+
+typedef struct ScreenshotContext {
+    unsigned char *data; /* image data */
+    size_t size;         /* image size */
+    ScreenshotFormat format;
+    int posx;
+    int posy;
+    size_t width;
+    size_t height;
+    float scale; /* pixels per desktop point, posx & posy are in points, 0 means 1 */
+    bool isPrimary;
+} ScreenshotContext;
+
+typedef struct ScreenshotOptions {
+    const char *input;  /* image path(s) for file backend, comma separated */
+    const char *layout; /* raw image layout or synthetic geometry, e.g. 1920x1080:bgra */
+} ScreenshotOptions;
+
+/*
+ * Receives a capture band by band. begin is called once per screen with
+ * geometry only, then band for each run of rows in RGBA8, top to bottom.
+ * Pixels are only valid during the call, a non zero return aborts capture.
+ */
+typedef struct ScreenshotBandSink {
+    int (*begin)(void *user, size_t idx, const ScreenshotContext *ctx);
+    int (*band)(void *user, size_t idx, int y, int height, const unsigned char *rgba);
+    void *user;
+} ScreenshotBandSink;
+
+/*
+ * Capture backend, capture fills up to capacity caller provided contexts and
+ * returns the count, or -1 on failure. RGBA data is allocated with malloc, so
+ * the caller may take it over and set data to NULL before calling release.
+ */
+typedef struct ScreenshotBackend {
+    const char *name;
+    const char *description;
+    bool fallback; /* tried automatically when no backend is specified */
+    bool (*probe)(const ScreenshotOptions *opts);
+    int (*capture)(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity);
+    void (*release)(ScreenshotContext *ctxArray, size_t count);
+    /* optional, fills geometry of ctxArray and streams pixels through sink */
+    int (*captureBands)(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity, const ScreenshotBandSink *sink);
+} ScreenshotBackend;
+
+const ScreenshotBackend *const *getScreenshotBackends(size_t *count);
+const ScreenshotBackend *findScreenshotBackend(const char *name);
+
+/* capture with backend by name, or walk through fallback chain if name is NULL */
+int captureScreenshot(const char *name, const ScreenshotOptions *opts,
+                      ScreenshotContext *ctxArray, size_t capacity,
+                      const ScreenshotBackend **backend);
+/*
+ * Same as captureScreenshot, but streams bands through sink when the backend
+ * supports it. Other backends capture whole frames, check data of contexts.
+ */
+int captureScreenshotBands(const char *name, const ScreenshotOptions *opts,
+                           ScreenshotContext *ctxArray, size_t capacity,
+                           const ScreenshotBandSink *sink, const ScreenshotBackend **backend);
+
+#endif
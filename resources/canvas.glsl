@@ -0,0 +1,168 @@
+#version 330
+// @variants: LENS GRID BICUBIC:LENS
+
+// Each combination is a separate program, see generate_shader_header.c:
+// LENS     magnifier around lensCenter, drawn as its own quad over every screen below it
+// GRID     pixel grid fading in with zoom
+// BICUBIC  bicubic filter inside the lens, nearest otherwise, only with LENS
+
+// Input vertex attributes from vertex shader
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+// Input uniform values
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+
+// Output fragment color
+out vec4 finalColor;
+
+// xy: world position of quad top-left, zw: world size of quad
+uniform vec4 texRect;
+
+#ifdef LENS
+#define LENS_MAX_SCREENS 4  // @export
+
+uniform vec2 lensCenter;      // world position
+uniform float lensRadius;     // world units
+uniform float magnification;
+uniform float pixelSize;      // world units per screen pixel
+
+// screens overlapping the lens, bound next to texture0
+uniform sampler2D screens[LENS_MAX_SCREENS];
+uniform vec4 screenRects[LENS_MAX_SCREENS];  // world rect of each screen
+uniform vec2 screenSizes[LENS_MAX_SCREENS];  // texture size of each screen
+uniform int screenCount;
+
+const vec4 backgroundColor = vec4(35.0 / 255.0, 35.0 / 255.0, 35.0 / 255.0, 1.0);
+const vec4 borderColor = vec4(1.0, 1.0, 1.0, 1.0);
+#endif
+
+#ifdef GRID
+const float gridOpacity = 0.35;
+#define GRID_FADE_START 6.0  // @export, screen pixels per texel
+const float gridFadeStart = GRID_FADE_START;
+const float gridFadeEnd = 10.0;
+#endif
+
+vec4 sampleNearest(sampler2D tex, vec2 uv) {
+    ivec2 size = textureSize(tex, 0);
+    ivec2 texel = clamp(ivec2(floor(uv * vec2(size))), ivec2(0), size - 1);
+    return texelFetch(tex, texel, 0);
+}
+
+#ifdef BICUBIC
+// Catmull-Rom bicubic in 9 bilinear taps, requires bilinear texture filter
+vec4 sampleBicubic(sampler2D tex, vec2 uv) {
+    vec2 texSize = vec2(textureSize(tex, 0));
+    vec2 samplePos = uv * texSize;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+
+    vec2 pos0 = (texPos1 - 1.0) / texSize;
+    vec2 pos3 = (texPos1 + 2.0) / texSize;
+    vec2 pos12 = (texPos1 + w2 / w12) / texSize;
+
+    vec4 color = vec4(0.0);
+    color += texture(tex, vec2(pos0.x, pos0.y)) * w0.x * w0.y;
+    color += texture(tex, vec2(pos12.x, pos0.y)) * w12.x * w0.y;
+    color += texture(tex, vec2(pos3.x, pos0.y)) * w3.x * w0.y;
+    color += texture(tex, vec2(pos0.x, pos12.y)) * w0.x * w12.y;
+    color += texture(tex, vec2(pos12.x, pos12.y)) * w12.x * w12.y;
+    color += texture(tex, vec2(pos3.x, pos12.y)) * w3.x * w12.y;
+    color += texture(tex, vec2(pos0.x, pos3.y)) * w0.x * w3.y;
+    color += texture(tex, vec2(pos12.x, pos3.y)) * w12.x * w3.y;
+    color += texture(tex, vec2(pos3.x, pos3.y)) * w3.x * w3.y;
+    return clamp(color, 0.0, 1.0);
+}
+#define sampleLens sampleBicubic
+#else
+#define sampleLens sampleNearest
+#endif
+
+#ifdef LENS
+// first screen containing worldPos, -1 over the background between screens
+int findScreen(vec2 worldPos) {
+    for (int i = 0; i < LENS_MAX_SCREENS; ++i) {
+        if (i >= screenCount) break;
+        vec4 rect = screenRects[i];
+        if (all(greaterThanEqual(worldPos, rect.xy)) && all(lessThan(worldPos, rect.xy + rect.zw))) return i;
+    }
+    return -1;
+}
+
+// sampler arrays only take constant indices in GLSL 330, one line per screen
+#if LENS_MAX_SCREENS != 4
+#error sampleScreen must cover LENS_MAX_SCREENS screens
+#endif
+vec4 sampleScreen(int screen, vec2 uv) {
+    if (screen == 0) return sampleLens(screens[0], uv);
+    if (screen == 1) return sampleLens(screens[1], uv);
+    if (screen == 2) return sampleLens(screens[2], uv);
+    if (screen == 3) return sampleLens(screens[3], uv);
+    return backgroundColor;
+}
+#endif
+
+#ifdef GRID
+// coverage of texel edges, 1 screen pixel wide, fading in as texels grow on screen
+float gridLine(vec2 texelPos) {
+    vec2 texelsPerPixel = max(fwidth(texelPos), vec2(1e-6));
+    vec2 edgeDist = abs(fract(texelPos - 0.5) - 0.5) / texelsPerPixel;
+    float line = 1.0 - clamp(min(edgeDist.x, edgeDist.y), 0.0, 1.0);
+    return line * smoothstep(gridFadeStart, gridFadeEnd, 1.0 / max(texelsPerPixel.x, texelsPerPixel.y));
+}
+#endif
+
+void main() {
+    vec2 worldPos = texRect.xy + fragTexCoord * texRect.zw;
+
+#ifdef LENS
+    // magnify around lens center, sampling whichever screen lies below
+    float dist = length(worldPos - lensCenter);
+    vec2 samplePos = lensCenter + (worldPos - lensCenter) / magnification;
+    int screen = findScreen(samplePos);
+    vec4 rect = screen < 0 ? vec4(0.0, 0.0, 1.0, 1.0) : screenRects[screen];
+    vec2 uv = (samplePos - rect.xy) / rect.zw;
+    vec2 texSize = screen < 0 ? vec2(1.0) : screenSizes[screen];
+#else
+    vec2 uv = fragTexCoord;
+    vec2 texSize = vec2(textureSize(texture0, 0));
+#endif
+
+#ifdef GRID
+    // derivatives must be taken in uniform control flow
+    float grid = gridOpacity * gridLine(uv * texSize);
+#endif
+
+#ifdef LENS
+    // discard only after derivatives, the quad is the bounding square of the lens
+    if (dist > lensRadius) discard;
+    vec4 texelColor = sampleScreen(screen, uv);
+#ifdef GRID
+    if (screen < 0) grid = 0.0;
+#endif
+#else
+    vec4 texelColor = sampleNearest(texture0, uv);
+#endif
+
+#ifdef GRID
+    // grid contrasting with the pixel below it
+    float luma = dot(texelColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+    texelColor.rgb = mix(texelColor.rgb, vec3(step(luma, 0.5)), grid);
+#endif
+
+#ifdef LENS
+    // thin border on lens edge
+    float border = smoothstep(lensRadius - 2.0 * pixelSize, lensRadius - pixelSize, dist);
+    texelColor = mix(texelColor, borderColor, border);
+#endif
+
+    finalColor = texelColor * colDiffuse * fragColor;
+}
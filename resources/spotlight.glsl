@@ -11,23 +11,54 @@ uniform vec4 colDiffuse;
 // Output fragment color
 out vec4 finalColor;
 
+#define MAX_SPOTLIGHTS 16  // @export
+
+#define SHAPE_CIRCLE 0
+#define SHAPE_ROUNDED_RECTANGLE 1
+#define SHAPE_ELLIPSE 2
+
 uniform float opacity;
-uniform vec2 center;
-uniform float radius;
 uniform int textureWidth;
 uniform int textureHeight;
+uniform int spotlightCount;
+// xy: center, zw: half size, in screen pixels
+uniform vec4 spotlightBounds[MAX_SPOTLIGHTS];
+// x: shape, y: corner radius, z: feather width
+uniform vec4 spotlightParams[MAX_SPOTLIGHTS];
+
+// Signed distance to spotlight shape, negative inside
+float shapeDistance(vec2 pos, vec4 bounds, vec4 params) {
+    vec2 d = pos - bounds.xy;
+    int shape = int(params.x);
+
+    if (shape == SHAPE_ROUNDED_RECTANGLE) {
+        float r = min(params.y, min(bounds.z, bounds.w));
+        vec2 q = abs(d) - bounds.zw + r;
+        return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+    }
+
+    if (shape == SHAPE_ELLIPSE) {
+        // first order approximation, exact on the axes
+        float k0 = length(d / bounds.zw);
+        float k1 = length(d / (bounds.zw * bounds.zw));
+        return k0 * (k0 - 1.0) / max(k1, 1e-4);
+    }
+
+    return length(d) - bounds.z;
+}
 
 void main() {
     vec2 texSize = vec2(float(textureWidth), float(textureHeight));
-    vec2 texCenter = fragTexCoord * texSize;
-    texCenter -= center;
-    float dist = length(texCenter);
-    vec4 color = fragColor;
-
-    if (dist > radius) {
-        float gray = 0.05;
-        color.rgba = vec4(gray, gray, gray, opacity);
+    vec2 pos = fragTexCoord * texSize;
+    float light = 0.0;
+
+    // union of all spotlights, evaluated in a single pass
+    for (int i = 0; i < spotlightCount; ++i) {
+        float dist = shapeDistance(pos, spotlightBounds[i], spotlightParams[i]);
+        float feather = max(spotlightParams[i].z, 1.0) * 0.5;
+        light = max(light, 1.0 - smoothstep(-feather, feather, dist));
     }
 
-    finalColor = color;
+    float gray = 0.05;
+    finalColor = vec4(gray, gray, gray, opacity * (1.0 - light));
 }
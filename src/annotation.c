@@ -0,0 +1,551 @@
+#include "annotation.h"
+
+#include <raymath.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANNOTATION_CELL_SIZE ((float)256.0f)
+#define ANNOTATION_BUCKET_COUNT 4096 /* must be power of two */
+#define ANNOTATION_ARROW_HEAD_SCALE ((float)4.0f)
+#define ANNOTATION_COMPACT_MIN_VERTICES 4096
+#define ANNOTATION_LAYER_SCALE ((float)1.5f) /* layer size relative to screen, margin for panning */
+#define ANNOTATION_ZOOM_STEPS ((float)8.0f)  /* cached zoom levels per doubling */
+
+typedef struct AnnotationStroke {
+    AnnotationTool tool;
+    Color color;
+    float thick;
+    size_t first; /* index of first vertex in vertex buffer */
+    size_t count; /* vertex count */
+    Rectangle bounds;
+    uint32_t stamp; /* last query this stroke was visited by */
+    bool erased;
+} AnnotationStroke;
+
+/* uniform grid cell of the spatial index, chained in a hash bucket */
+typedef struct AnnotationCell {
+    int cx;
+    int cy;
+    int *ids;
+    size_t length;
+    size_t capacity;
+    struct AnnotationCell *next;
+} AnnotationCell;
+
+static struct AnnotationContext {
+    Vector2 *vertices;
+    size_t vertexCount;
+    size_t vertexCapacity;
+    size_t garbageVertexCount;
+
+    AnnotationStroke *strokes;
+    size_t strokeCount;
+    size_t strokeCapacity;
+    size_t liveStrokeCount;
+
+    AnnotationCell *buckets[ANNOTATION_BUCKET_COUNT];
+    uint32_t queryStamp;
+
+    int *pending; /* committed strokes not yet rasterized into layer */
+    size_t pendingCount;
+    size_t pendingCapacity;
+
+    int *visible; /* scratch buffer for visibility query */
+    size_t visibleCapacity;
+
+    bool drawing; /* last stroke is in progress */
+    bool layerDirty;
+    float layerZoom;     /* zoom level layer is rasterized at, 0 before first use */
+    Vector2 layerOrigin; /* world position of layer top-left */
+    RenderTexture2D layer;
+    int width;
+    int height;
+} annotationCtx = {0};
+
+static const char *toolNames[ANNOTATION_TOOL_COUNT] = {
+    [ANNOTATION_TOOL_NONE] = "none",
+    [ANNOTATION_TOOL_PEN] = "pen",
+    [ANNOTATION_TOOL_ARROW] = "arrow",
+    [ANNOTATION_TOOL_RECTANGLE] = "rectangle",
+    [ANNOTATION_TOOL_ERASER] = "eraser",
+};
+
+static bool growArray(void **array, size_t *capacity, size_t required, size_t elementSize) {
+    if (required <= *capacity) return true;
+    size_t newCapacity = *capacity ? *capacity : 64;
+    while (newCapacity < required) newCapacity *= 2;
+    void *newArray = realloc(*array, newCapacity * elementSize);
+    if (newArray == NULL) return false;
+    *array = newArray;
+    *capacity = newCapacity;
+    return true;
+}
+
+static inline int cellCoord(float v) {
+    return (int)floorf(v / ANNOTATION_CELL_SIZE);
+}
+
+static inline size_t cellHash(int cx, int cy) {
+    return ((size_t)((unsigned)cx * 73856093u) ^ (size_t)((unsigned)cy * 19349663u)) & (ANNOTATION_BUCKET_COUNT - 1);
+}
+
+static AnnotationCell *findCell(int cx, int cy, bool create) {
+    size_t hash = cellHash(cx, cy);
+    for (AnnotationCell *cell = annotationCtx.buckets[hash]; cell; cell = cell->next) {
+        if (cell->cx == cx && cell->cy == cy) return cell;
+    }
+    if (!create) return NULL;
+
+    AnnotationCell *cell = calloc(1, sizeof(AnnotationCell));
+    if (cell == NULL) return NULL;
+    cell->cx = cx;
+    cell->cy = cy;
+    cell->next = annotationCtx.buckets[hash];
+    annotationCtx.buckets[hash] = cell;
+    return cell;
+}
+
+static void freeCells(void) {
+    for (size_t i = 0; i < ANNOTATION_BUCKET_COUNT; ++i) {
+        AnnotationCell *cell = annotationCtx.buckets[i];
+        while (cell) {
+            AnnotationCell *next = cell->next;
+            free(cell->ids);
+            free(cell);
+            cell = next;
+        }
+        annotationCtx.buckets[i] = NULL;
+    }
+}
+
+static size_t strokeSegmentCount(const AnnotationStroke *stroke) {
+    switch (stroke->tool) {
+    case ANNOTATION_TOOL_PEN:
+        return stroke->count > 1 ? stroke->count - 1 : 1;
+    case ANNOTATION_TOOL_ARROW:
+        return 1;
+    case ANNOTATION_TOOL_RECTANGLE:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static void strokeSegment(const AnnotationStroke *stroke, size_t idx, Vector2 *a, Vector2 *b) {
+    const Vector2 *v = annotationCtx.vertices + stroke->first;
+    if (stroke->tool == ANNOTATION_TOOL_RECTANGLE) {
+        Vector2 corners[4] = {v[0], {v[1].x, v[0].y}, v[1], {v[0].x, v[1].y}};
+        *a = corners[idx];
+        *b = corners[(idx + 1) % 4];
+        return;
+    }
+    if (stroke->count == 1) {
+        *a = *b = v[0];
+        return;
+    }
+    *a = v[idx];
+    *b = v[idx + 1];
+}
+
+/* visit every grid cell overlapped by stroke segments, inflated by half thickness */
+static void indexStroke(int id, bool insert) {
+    AnnotationStroke *stroke = &annotationCtx.strokes[id];
+    float pad = stroke->thick * 0.5f;
+    size_t segCnt = strokeSegmentCount(stroke);
+
+    for (size_t s = 0; s < segCnt; ++s) {
+        Vector2 a, b;
+        strokeSegment(stroke, s, &a, &b);
+        int x0 = cellCoord(fminf(a.x, b.x) - pad), x1 = cellCoord(fmaxf(a.x, b.x) + pad);
+        int y0 = cellCoord(fminf(a.y, b.y) - pad), y1 = cellCoord(fmaxf(a.y, b.y) + pad);
+
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                AnnotationCell *cell = findCell(cx, cy, insert);
+                if (cell == NULL) continue;
+                if (insert) {
+                    /* consecutive segments mostly hit the same cells */
+                    if (cell->length && cell->ids[cell->length - 1] == id) continue;
+                    if (!growArray((void **)&cell->ids, &cell->capacity, cell->length + 1, sizeof(int))) continue;
+                    cell->ids[cell->length++] = id;
+                } else {
+                    for (size_t k = 0; k < cell->length;) {
+                        if (cell->ids[k] == id) {
+                            cell->ids[k] = cell->ids[--cell->length];
+                        } else {
+                            ++k;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void updateStrokeBounds(AnnotationStroke *stroke) {
+    const Vector2 *v = annotationCtx.vertices + stroke->first;
+    float minx = v[0].x, maxx = v[0].x, miny = v[0].y, maxy = v[0].y;
+    for (size_t i = 1; i < stroke->count; ++i) {
+        minx = fminf(minx, v[i].x);
+        maxx = fmaxf(maxx, v[i].x);
+        miny = fminf(miny, v[i].y);
+        maxy = fmaxf(maxy, v[i].y);
+    }
+    float pad = stroke->thick * (stroke->tool == ANNOTATION_TOOL_ARROW ? ANNOTATION_ARROW_HEAD_SCALE : 0.5f);
+    stroke->bounds = (Rectangle){minx - pad, miny - pad, maxx - minx + pad * 2.0f, maxy - miny + pad * 2.0f};
+}
+
+static void drawStroke(const AnnotationStroke *stroke) {
+    const Vector2 *v = annotationCtx.vertices + stroke->first;
+
+    switch (stroke->tool) {
+    case ANNOTATION_TOOL_PEN:
+        if (stroke->count == 1) {
+            DrawCircleV(v[0], stroke->thick * 0.5f, stroke->color);
+        } else {
+            DrawSplineLinear(v, (int)stroke->count, stroke->thick, stroke->color);
+        }
+        break;
+    case ANNOTATION_TOOL_ARROW: {
+        Vector2 dir = Vector2Subtract(v[1], v[0]);
+        float len = Vector2Length(dir);
+        if (len <= 0.0f) break;
+        dir = Vector2Scale(dir, 1.0f / len);
+        float headLen = fminf(stroke->thick * ANNOTATION_ARROW_HEAD_SCALE, len);
+        Vector2 base = Vector2Subtract(v[1], Vector2Scale(dir, headLen));
+        Vector2 perp = {-dir.y * headLen * 0.5f, dir.x * headLen * 0.5f};
+        DrawLineEx(v[0], base, stroke->thick, stroke->color);
+        /* raylib expects counter-clockwise vertex order */
+        DrawTriangle(v[1], Vector2Subtract(base, perp), Vector2Add(base, perp), stroke->color);
+        break;
+    }
+    case ANNOTATION_TOOL_RECTANGLE: {
+        Rectangle rec = {fminf(v[0].x, v[1].x), fminf(v[0].y, v[1].y), fabsf(v[1].x - v[0].x), fabsf(v[1].y - v[0].y)};
+        DrawRectangleLinesEx(rec, stroke->thick, stroke->color);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static int compareInt(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+/* collect ids of live strokes intersecting view in drawing order */
+static size_t queryStrokes(Rectangle view) {
+    size_t count = 0;
+    int x0 = cellCoord(view.x), x1 = cellCoord(view.x + view.width);
+    int y0 = cellCoord(view.y), y1 = cellCoord(view.y + view.height);
+    size_t cellCnt = (size_t)(x1 - x0 + 1) * (size_t)(y1 - y0 + 1);
+
+    if (!growArray((void **)&annotationCtx.visible, &annotationCtx.visibleCapacity, annotationCtx.liveStrokeCount, sizeof(int))) {
+        return 0;
+    }
+
+    /* zoomed far out, scanning strokes is cheaper than scanning cells */
+    if (cellCnt >= annotationCtx.liveStrokeCount) {
+        for (size_t i = 0; i < annotationCtx.strokeCount; ++i) {
+            if (annotationCtx.strokes[i].erased) continue;
+            if (!CheckCollisionRecs(annotationCtx.strokes[i].bounds, view)) continue;
+            annotationCtx.visible[count++] = (int)i;
+        }
+        return count;
+    }
+
+    uint32_t stamp = ++annotationCtx.queryStamp;
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            AnnotationCell *cell = findCell(cx, cy, false);
+            if (cell == NULL) continue;
+            for (size_t k = 0; k < cell->length; ++k) {
+                AnnotationStroke *stroke = &annotationCtx.strokes[cell->ids[k]];
+                if (stroke->stamp == stamp) continue;
+                stroke->stamp = stamp;
+                annotationCtx.visible[count++] = cell->ids[k];
+            }
+        }
+    }
+    qsort(annotationCtx.visible, count, sizeof(int), compareInt);
+    return count;
+}
+
+static Rectangle cameraView(Camera2D camera) {
+    Vector2 topLeft = GetScreenToWorld2D((Vector2){0, 0}, camera);
+    Vector2 bottomRight = GetScreenToWorld2D((Vector2){(float)annotationCtx.width, (float)annotationCtx.height}, camera);
+    return (Rectangle){topLeft.x, topLeft.y, bottomRight.x - topLeft.x, bottomRight.y - topLeft.y};
+}
+
+/* smallest cached level not below zoom, so the layer is only ever scaled down a little */
+static float layerLevelZoom(float zoom) {
+    return exp2f(ceilf(log2f(zoom) * ANNOTATION_ZOOM_STEPS) / ANNOTATION_ZOOM_STEPS);
+}
+
+static Rectangle layerWorldRect(void) {
+    return (Rectangle){annotationCtx.layerOrigin.x, annotationCtx.layerOrigin.y,
+                       annotationCtx.layer.texture.width / annotationCtx.layerZoom,
+                       annotationCtx.layer.texture.height / annotationCtx.layerZoom};
+}
+
+/* drop erased vertices from vertex buffer, stroke ids stay stable */
+static void compactVertices(void) {
+    size_t dst = 0;
+    for (size_t i = 0; i < annotationCtx.strokeCount; ++i) {
+        AnnotationStroke *stroke = &annotationCtx.strokes[i];
+        if (stroke->erased) {
+            stroke->count = 0;
+            stroke->first = dst;
+            continue;
+        }
+        memmove(annotationCtx.vertices + dst, annotationCtx.vertices + stroke->first, stroke->count * sizeof(Vector2));
+        stroke->first = dst;
+        dst += stroke->count;
+    }
+    annotationCtx.vertexCount = dst;
+    annotationCtx.garbageVertexCount = 0;
+}
+
+static void removeStroke(int id) {
+    AnnotationStroke *stroke = &annotationCtx.strokes[id];
+    indexStroke(id, false);
+    stroke->erased = true;
+    annotationCtx.garbageVertexCount += stroke->count;
+    --annotationCtx.liveStrokeCount;
+    annotationCtx.layerDirty = true;
+
+    /* trim erased strokes from the tail, their vertices are at the tail too */
+    while (annotationCtx.strokeCount && annotationCtx.strokes[annotationCtx.strokeCount - 1].erased) {
+        AnnotationStroke *last = &annotationCtx.strokes[annotationCtx.strokeCount - 1];
+        if (last->first + last->count == annotationCtx.vertexCount) {
+            annotationCtx.vertexCount = last->first;
+            annotationCtx.garbageVertexCount -= last->count;
+        }
+        --annotationCtx.strokeCount;
+    }
+
+    if (annotationCtx.garbageVertexCount > ANNOTATION_COMPACT_MIN_VERTICES &&
+        annotationCtx.garbageVertexCount * 2 > annotationCtx.vertexCount) {
+        compactVertices();
+    }
+}
+
+int initAnnotationLayer(int width, int height) {
+    annotationCtx.width = width;
+    annotationCtx.height = height;
+    annotationCtx.layer = LoadRenderTexture((int)(width * ANNOTATION_LAYER_SCALE), (int)(height * ANNOTATION_LAYER_SCALE));
+    if (annotationCtx.layer.id == 0) return -1;
+    /* layer is scaled down slightly between zoom levels */
+    SetTextureFilter(annotationCtx.layer.texture, TEXTURE_FILTER_BILINEAR);
+    annotationCtx.layerDirty = true;
+    return 0;
+}
+
+void unloadAnnotationLayer(void) {
+    clearAnnotationLayer();
+    UnloadRenderTexture(annotationCtx.layer);
+    free(annotationCtx.vertices);
+    free(annotationCtx.strokes);
+    free(annotationCtx.pending);
+    free(annotationCtx.visible);
+    memset(&annotationCtx, 0, sizeof(annotationCtx));
+}
+
+void beginAnnotationStroke(AnnotationTool tool, Vector2 worldPos, float thick, Color color) {
+    if (tool == ANNOTATION_TOOL_NONE || tool == ANNOTATION_TOOL_ERASER) return;
+    if (annotationCtx.drawing) endAnnotationStroke();
+
+    /* shapes keep two vertices: start & end */
+    size_t vertexCnt = tool == ANNOTATION_TOOL_PEN ? 1 : 2;
+    if (!growArray((void **)&annotationCtx.strokes, &annotationCtx.strokeCapacity, annotationCtx.strokeCount + 1, sizeof(AnnotationStroke)) ||
+        !growArray((void **)&annotationCtx.vertices, &annotationCtx.vertexCapacity, annotationCtx.vertexCount + vertexCnt, sizeof(Vector2))) {
+        TraceLog(LOG_WARNING, "failed to alloc memory for annotation stroke");
+        return;
+    }
+
+    AnnotationStroke *stroke = &annotationCtx.strokes[annotationCtx.strokeCount++];
+    *stroke = (AnnotationStroke){
+        .tool = tool,
+        .color = color,
+        .thick = thick,
+        .first = annotationCtx.vertexCount,
+        .count = vertexCnt,
+    };
+    for (size_t i = 0; i < vertexCnt; ++i) {
+        annotationCtx.vertices[annotationCtx.vertexCount++] = worldPos;
+    }
+    annotationCtx.drawing = true;
+}
+
+void extendAnnotationStroke(Vector2 worldPos, float minDistance) {
+    if (!annotationCtx.drawing) return;
+    AnnotationStroke *stroke = &annotationCtx.strokes[annotationCtx.strokeCount - 1];
+
+    if (stroke->tool != ANNOTATION_TOOL_PEN) {
+        annotationCtx.vertices[stroke->first + 1] = worldPos;
+        return;
+    }
+
+    Vector2 last = annotationCtx.vertices[stroke->first + stroke->count - 1];
+    if (Vector2DistanceSqr(last, worldPos) < minDistance * minDistance) return;
+    if (!growArray((void **)&annotationCtx.vertices, &annotationCtx.vertexCapacity, annotationCtx.vertexCount + 1, sizeof(Vector2))) {
+        return;
+    }
+    annotationCtx.vertices[annotationCtx.vertexCount++] = worldPos;
+    ++stroke->count;
+}
+
+void endAnnotationStroke(void) {
+    if (!annotationCtx.drawing) return;
+    annotationCtx.drawing = false;
+
+    int id = (int)annotationCtx.strokeCount - 1;
+    AnnotationStroke *stroke = &annotationCtx.strokes[id];
+    updateStrokeBounds(stroke);
+    indexStroke(id, true);
+    ++annotationCtx.liveStrokeCount;
+
+    if (!growArray((void **)&annotationCtx.pending, &annotationCtx.pendingCapacity, annotationCtx.pendingCount + 1, sizeof(int))) {
+        annotationCtx.layerDirty = true;
+        return;
+    }
+    annotationCtx.pending[annotationCtx.pendingCount++] = id;
+}
+
+size_t eraseAnnotationStrokes(Vector2 worldPos, float radius) {
+    size_t erased = 0;
+    AnnotationCell *cell;
+    int x0 = cellCoord(worldPos.x - radius), x1 = cellCoord(worldPos.x + radius);
+    int y0 = cellCoord(worldPos.y - radius), y1 = cellCoord(worldPos.y + radius);
+
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            cell = findCell(cx, cy, false);
+            if (cell == NULL) continue;
+            for (size_t k = 0; k < cell->length;) {
+                int id = cell->ids[k];
+                AnnotationStroke *stroke = &annotationCtx.strokes[id];
+                bool hit = false;
+                float hitDist = radius + stroke->thick * 0.5f;
+
+                for (size_t s = 0, segCnt = strokeSegmentCount(stroke); s < segCnt && !hit; ++s) {
+                    Vector2 a, b;
+                    strokeSegment(stroke, s, &a, &b);
+                    Vector2 ab = Vector2Subtract(b, a);
+                    float lenSqr = Vector2LengthSqr(ab);
+                    float t = lenSqr > 0.0f ? Clamp(Vector2DotProduct(Vector2Subtract(worldPos, a), ab) / lenSqr, 0.0f, 1.0f) : 0.0f;
+                    hit = Vector2DistanceSqr(worldPos, Vector2Add(a, Vector2Scale(ab, t))) <= hitDist * hitDist;
+                }
+
+                if (hit) {
+                    /* removal swaps ids within this cell, so re-check slot k */
+                    removeStroke(id);
+                    ++erased;
+                } else {
+                    ++k;
+                }
+            }
+        }
+    }
+    return erased;
+}
+
+bool undoAnnotationStroke(void) {
+    if (annotationCtx.drawing) {
+        annotationCtx.drawing = false;
+        annotationCtx.vertexCount = annotationCtx.strokes[--annotationCtx.strokeCount].first;
+        return true;
+    }
+    for (size_t i = annotationCtx.strokeCount; i > 0; --i) {
+        if (annotationCtx.strokes[i - 1].erased) continue;
+        removeStroke((int)i - 1);
+        return true;
+    }
+    return false;
+}
+
+void clearAnnotationLayer(void) {
+    freeCells();
+    annotationCtx.vertexCount = 0;
+    annotationCtx.garbageVertexCount = 0;
+    annotationCtx.strokeCount = 0;
+    annotationCtx.liveStrokeCount = 0;
+    annotationCtx.pendingCount = 0;
+    annotationCtx.drawing = false;
+    annotationCtx.layerDirty = true;
+}
+
+void updateAnnotationLayer(Camera2D camera) {
+    /* panning within the cached area & zooming within a level only move the blit */
+    Rectangle view = cameraView(camera);
+    float level = layerLevelZoom(camera.zoom);
+    if (level != annotationCtx.layerZoom) {
+        annotationCtx.layerZoom = level;
+        annotationCtx.layerDirty = true;
+    }
+    Rectangle cached = layerWorldRect();
+    if (view.x < cached.x || view.y < cached.y ||
+        view.x + view.width > cached.x + cached.width || view.y + view.height > cached.y + cached.height) {
+        annotationCtx.layerDirty = true;
+    }
+    if (!annotationCtx.layerDirty && !annotationCtx.pendingCount) return;
+
+    if (annotationCtx.layerDirty) {
+        /* center cached area on the view */
+        annotationCtx.layerOrigin = (Vector2){view.x + (view.width - cached.width) * 0.5f, view.y + (view.height - cached.height) * 0.5f};
+        cached = layerWorldRect();
+    }
+    Camera2D layerCamera = {.target = annotationCtx.layerOrigin, .zoom = level};
+
+    // clang-format off
+    BeginTextureMode(annotationCtx.layer);
+        if (annotationCtx.layerDirty) ClearBackground(BLANK);
+        BeginMode2D(layerCamera);
+            if (annotationCtx.layerDirty) {
+                size_t count = queryStrokes(cached);
+                for (size_t i = 0; i < count; ++i) {
+                    drawStroke(&annotationCtx.strokes[annotationCtx.visible[i]]);
+                }
+            } else {
+                for (size_t i = 0; i < annotationCtx.pendingCount; ++i) {
+                    if (annotationCtx.strokes[annotationCtx.pending[i]].erased) continue;
+                    drawStroke(&annotationCtx.strokes[annotationCtx.pending[i]]);
+                }
+            }
+        EndMode2D();
+    EndTextureMode();
+    // clang-format on
+
+    annotationCtx.layerDirty = false;
+    annotationCtx.pendingCount = 0;
+}
+
+void drawAnnotationLayer(Camera2D camera) {
+    if (annotationCtx.liveStrokeCount) {
+        /* render texture is y-flipped */
+        Rectangle src = {0, 0, (float)annotationCtx.layer.texture.width, -(float)annotationCtx.layer.texture.height};
+        Vector2 pos = GetWorldToScreen2D(annotationCtx.layerOrigin, camera);
+        float scale = camera.zoom / annotationCtx.layerZoom;
+        Rectangle dst = {pos.x, pos.y, annotationCtx.layer.texture.width * scale, annotationCtx.layer.texture.height * scale};
+        DrawTexturePro(annotationCtx.layer.texture, src, dst, (Vector2){0, 0}, 0.0f, WHITE);
+    }
+    if (annotationCtx.drawing) {
+        BeginMode2D(camera);
+        drawStroke(&annotationCtx.strokes[annotationCtx.strokeCount - 1]);
+        EndMode2D();
+    }
+}
+
+size_t getAnnotationStrokeCount(void) {
+    return annotationCtx.liveStrokeCount;
+}
+
+size_t getAnnotationVertexCount(void) {
+    return annotationCtx.vertexCount - annotationCtx.garbageVertexCount;
+}
+
+const char *getAnnotationToolName(AnnotationTool tool) {
+    if (tool < 0 || tool >= ANNOTATION_TOOL_COUNT) return "unknown";
+    return toolNames[tool];
+}
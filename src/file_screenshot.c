@@ -0,0 +1,418 @@
+#include "file_screenshot.h"
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memstat.h"
+
+#define SYNTHETIC_DEFAULT_LAYOUT "1920x1080"
+#define MAX_PATH_LENGTH 4096
+
+typedef struct RawLayout {
+    int width;
+    int height;
+    int channels;
+    int order[4]; /* source channel of r, g, b, a, -1 means opaque */
+} RawLayout;
+
+static void releaseScreenshot(ScreenshotContext *ctxArray, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (ctxArray[i].data) subMemStat(MEM_STAGE_CONTEXT, ctxArray[i].size);
+        free(ctxArray[i].data);
+        ctxArray[i].data = NULL;
+    }
+}
+
+/* parse `WIDTHxHEIGHT' and advance p */
+static bool parseSize(const char **p, int *width, int *height) {
+    char *end;
+    long w = strtol(*p, &end, 10);
+    if (end == *p || (*end != 'x' && *end != 'X')) return false;
+    const char *q = end + 1;
+    long h = strtol(q, &end, 10);
+    if (end == q || w <= 0 || h <= 0) return false;
+    *width = (int)w;
+    *height = (int)h;
+    *p = end;
+    return true;
+}
+
+/* optional `@SCALE' suffix of a synthetic screen, pixels per desktop point */
+static bool parseScale(const char **p, float *scale) {
+    *scale = 1.0f;
+    if (**p != '@') return true;
+    char *end;
+    float s = strtof(*p + 1, &end);
+    if (end == *p + 1 || s <= 0.0f) return false;
+    *scale = s;
+    *p = end;
+    return true;
+}
+
+/* parse `WIDTHxHEIGHT[:rgba|bgra|rgb|bgr]' */
+static bool parseRawLayout(const char *desc, RawLayout *layout) {
+    static const struct {
+        const char *name;
+        int channels;
+        int order[4];
+    } formats[] = {
+        {"rgba", 4, {0, 1, 2, 3}},
+        {"bgra", 4, {2, 1, 0, 3}},
+        {"rgbx", 4, {0, 1, 2, -1}},
+        {"bgrx", 4, {2, 1, 0, -1}},
+        {"rgb", 3, {0, 1, 2, -1}},
+        {"bgr", 3, {2, 1, 0, -1}},
+    };
+
+    if (!parseSize(&desc, &layout->width, &layout->height)) return false;
+    const char *format = *desc == ':' ? desc + 1 : "rgba";
+    if (*desc && *desc != ':') return false;
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        if (strcmp(formats[i].name, format)) continue;
+        layout->channels = formats[i].channels;
+        memcpy(layout->order, formats[i].order, sizeof(layout->order));
+        return true;
+    }
+    return false;
+}
+
+static void convertRawPixels(const unsigned char *src, unsigned char *rgba, size_t pixelCnt, const RawLayout *layout) {
+    for (size_t i = 0; i < pixelCnt; ++i) {
+        const unsigned char *px = src + i * layout->channels;
+        for (int c = 0; c < 4; ++c) {
+            rgba[i * 4 + c] = layout->order[c] < 0 ? 255 : px[layout->order[c]];
+        }
+    }
+}
+
+static unsigned char *loadRawImage(const char *path, const RawLayout *layout) {
+    size_t pixelCnt = (size_t)layout->width * layout->height;
+    size_t srcSize = pixelCnt * layout->channels;
+    unsigned char *src = NULL, *rgba = NULL;
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", path);
+        return NULL;
+    }
+    src = malloc(srcSize);
+    if (src == NULL || fread(src, 1, srcSize, fp) != srcSize) {
+        fprintf(stderr, "Failed to read %zu bytes of raw image from %s\n", srcSize, path);
+        goto read_failed;
+    }
+    addMemStat(MEM_STAGE_CAPTURE, srcSize);
+    rgba = malloc(pixelCnt * 4);
+    if (rgba == NULL) {
+        fprintf(stderr, "Failed to alloc memory for rgba_data\n");
+        goto alloc_rgba_failed;
+    }
+    convertRawPixels(src, rgba, pixelCnt, layout);
+
+alloc_rgba_failed:
+    subMemStat(MEM_STAGE_CAPTURE, srcSize);
+read_failed:
+    free(src);
+    fclose(fp);
+    return rgba;
+}
+
+static bool probeFile(const ScreenshotOptions *opts) {
+    if (opts == NULL || opts->input == NULL) return false;
+
+    char path[MAX_PATH_LENGTH];
+    for (const char *p = opts->input; *p;) {
+        size_t len = strcspn(p, ",");
+        snprintf(path, sizeof(path), "%.*s", (int)len, p);
+        if (access(path, R_OK)) {
+            fprintf(stderr, "Failed to access file: %s\n", path);
+            return false;
+        }
+        p += len + (p[len] == ',');
+    }
+    return true;
+}
+
+/*
+ * Load one screenshot per comma separated input, placed left to right.
+ * With a layout description inputs are read as headerless raw pixels,
+ * otherwise any format raylib can decode (png, qoi, ...) is accepted.
+ */
+static int captureScreenshotFile(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity) {
+    RawLayout layout;
+    if (opts->layout && !parseRawLayout(opts->layout, &layout)) {
+        fprintf(stderr, "Invalid raw layout: %s, expected WIDTHxHEIGHT[:rgba|bgra|rgbx|bgrx|rgb|bgr]\n", opts->layout);
+        return -1;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    size_t count = 0;
+    int posx = 0;
+    for (const char *p = opts->input; *p && count < capacity; ++count) {
+        size_t len = strcspn(p, ",");
+        snprintf(path, sizeof(path), "%.*s", (int)len, p);
+        p += len + (p[len] == ',');
+
+        ScreenshotContext *ctx = &ctxArray[count];
+        if (opts->layout) {
+            ctx->data = loadRawImage(path, &layout);
+            ctx->width = layout.width;
+            ctx->height = layout.height;
+        } else {
+            /* raylib allocates with RL_MALLOC, which is malloc by default */
+            Image image = LoadImage(path);
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            ctx->data = image.data;
+            ctx->width = image.width;
+            ctx->height = image.height;
+        }
+        if (ctx->data == NULL) {
+            fprintf(stderr, "Failed to load image: %s\n", path);
+            releaseScreenshot(ctxArray, count);
+            return -1;
+        }
+
+        ctx->size = ctx->width * ctx->height * 4;
+        addMemStat(MEM_STAGE_CONTEXT, ctx->size);
+        ctx->format = SCREENSHOT_FORMAT_RGBA;
+        ctx->posx = posx;
+        ctx->posy = 0;
+        ctx->scale = 1.0f;
+        ctx->isPrimary = count == 0;
+        posx += (int)ctx->width;
+    }
+    return (int)count;
+}
+
+/* stream one input through sink, raw input a band at a time, encoded images are decoded whole */
+static int streamFile(const char *path, const RawLayout *layout, size_t idx, ScreenshotContext *ctx, const ScreenshotBandSink *sink) {
+    Image image = {0};
+    FILE *fp = NULL;
+    unsigned char *src = NULL, *band = NULL;
+    size_t srcSize = 0, bandSize = 0;
+    int ret = -1;
+
+    if (layout) {
+        fp = fopen(path, "rb");
+        if (fp == NULL) {
+            fprintf(stderr, "Failed to open file: %s\n", path);
+            return -1;
+        }
+        ctx->width = layout->width;
+        ctx->height = layout->height;
+        srcSize = (size_t)layout->width * SCREENSHOT_BAND_HEIGHT * layout->channels;
+        bandSize = (size_t)layout->width * SCREENSHOT_BAND_HEIGHT * 4;
+        src = malloc(srcSize);
+        band = malloc(bandSize);
+        if (src == NULL || band == NULL) {
+            fprintf(stderr, "Failed to alloc memory for band\n");
+            goto stream_failed;
+        }
+        addMemStat(MEM_STAGE_BAND, srcSize + bandSize);
+    } else {
+        image = LoadImage(path);
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        if (image.data == NULL) {
+            fprintf(stderr, "Failed to load image: %s\n", path);
+            return -1;
+        }
+        ctx->width = image.width;
+        ctx->height = image.height;
+        addMemStat(MEM_STAGE_CAPTURE, ctx->width * ctx->height * 4);
+    }
+    ctx->size = ctx->width * ctx->height * 4;
+    if (sink->begin(sink->user, idx, ctx)) goto sink_failed;
+
+    for (int y = 0; y < (int)ctx->height; y += SCREENSHOT_BAND_HEIGHT) {
+        int rows = (int)ctx->height - y < SCREENSHOT_BAND_HEIGHT ? (int)ctx->height - y : SCREENSHOT_BAND_HEIGHT;
+        const unsigned char *rgba = (const unsigned char *)image.data + (size_t)y * ctx->width * 4;
+        if (layout) {
+            size_t rowBytes = (size_t)layout->width * layout->channels;
+            if (fread(src, rowBytes, rows, fp) != (size_t)rows) {
+                fprintf(stderr, "Failed to read raw image rows from %s\n", path);
+                goto sink_failed;
+            }
+            convertRawPixels(src, band, (size_t)layout->width * rows, layout);
+            rgba = band;
+        }
+        if (sink->band(sink->user, idx, y, rows, rgba)) goto sink_failed;
+    }
+    ret = 0;
+
+sink_failed:
+    if (layout) {
+        subMemStat(MEM_STAGE_BAND, srcSize + bandSize);
+    } else {
+        subMemStat(MEM_STAGE_CAPTURE, ctx->width * ctx->height * 4);
+    }
+stream_failed:
+    free(src);
+    free(band);
+    if (fp) fclose(fp);
+    UnloadImage(image);
+    return ret;
+}
+
+static int captureScreenshotBandsFile(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity,
+                                      const ScreenshotBandSink *sink) {
+    RawLayout layout;
+    if (opts->layout && !parseRawLayout(opts->layout, &layout)) {
+        fprintf(stderr, "Invalid raw layout: %s, expected WIDTHxHEIGHT[:rgba|bgra|rgbx|bgrx|rgb|bgr]\n", opts->layout);
+        return -1;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    size_t count = 0;
+    int posx = 0;
+    for (const char *p = opts->input; *p && count < capacity; ++count) {
+        size_t len = strcspn(p, ",");
+        snprintf(path, sizeof(path), "%.*s", (int)len, p);
+        p += len + (p[len] == ',');
+
+        ScreenshotContext *ctx = &ctxArray[count];
+        *ctx = (ScreenshotContext){.format = SCREENSHOT_FORMAT_RGBA, .posx = posx, .scale = 1.0f, .isPrimary = count == 0};
+        if (streamFile(path, opts->layout ? &layout : NULL, count, ctx, sink)) return -1;
+        posx += (int)ctx->width;
+    }
+    return (int)count;
+}
+
+static bool probeSynthetic([[maybe_unused]] const ScreenshotOptions *opts) {
+    return true;
+}
+
+/*
+ * Gradient with a checkerboard & 100 pixel grid, useful for benchmarking
+ * without a display. Draws rows [y0, y0 + rows) of a width x height pattern.
+ */
+static void drawTestPattern(unsigned char *rgba, int width, int height, int y0, int rows, int idx) {
+    for (int y = y0; y < y0 + rows; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char *px = rgba + ((size_t)(y - y0) * width + x) * 4;
+            bool dark = ((x >> 5) ^ (y >> 5)) & 1;
+            bool grid = x % 100 == 0 || y % 100 == 0;
+
+            px[0] = (unsigned char)(x * 255 / width);
+            px[1] = (unsigned char)(y * 255 / height);
+            px[2] = (unsigned char)(idx * 85);
+            if (dark) {
+                px[0] /= 2;
+                px[1] /= 2;
+                px[2] /= 2;
+            }
+            if (grid) px[0] = px[1] = px[2] = 255;
+            px[3] = 255;
+        }
+    }
+}
+
+/* one screenshot per comma separated `WIDTHxHEIGHT[@SCALE]' in layout, placed left to right */
+static int captureScreenshotSynthetic(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity) {
+    const char *p = opts && opts->layout ? opts->layout : SYNTHETIC_DEFAULT_LAYOUT;
+    size_t count = 0;
+    int posx = 0;
+
+    for (; *p && count < capacity; ++count) {
+        int width, height;
+        float scale;
+        if (!parseSize(&p, &width, &height) || !parseScale(&p, &scale) || (*p && *p != ',')) {
+            fprintf(stderr, "Invalid synthetic layout: %s, expected WIDTHxHEIGHT[@SCALE][,WIDTHxHEIGHT[@SCALE]...]\n", opts->layout);
+            releaseScreenshot(ctxArray, count);
+            return -1;
+        }
+        if (*p == ',') ++p;
+
+        ScreenshotContext *ctx = &ctxArray[count];
+        ctx->size = (size_t)width * height * 4;
+        ctx->data = malloc(ctx->size);
+        if (ctx->data == NULL) {
+            fprintf(stderr, "Failed to alloc memory for rgba_data\n");
+            releaseScreenshot(ctxArray, count);
+            return -1;
+        }
+        addMemStat(MEM_STAGE_CONTEXT, ctx->size);
+        drawTestPattern(ctx->data, width, height, 0, height, (int)count);
+        ctx->format = SCREENSHOT_FORMAT_RGBA;
+        ctx->width = width;
+        ctx->height = height;
+        ctx->posx = posx;
+        ctx->posy = 0;
+        ctx->scale = scale;
+        ctx->isPrimary = count == 0;
+        posx += (int)(width / scale);
+    }
+    return (int)count;
+}
+
+static int captureScreenshotBandsSynthetic(const ScreenshotOptions *opts, ScreenshotContext *ctxArray, size_t capacity,
+                                           const ScreenshotBandSink *sink) {
+    const char *p = opts && opts->layout ? opts->layout : SYNTHETIC_DEFAULT_LAYOUT;
+    size_t count = 0;
+    int posx = 0;
+
+    for (; *p && count < capacity; ++count) {
+        int width, height;
+        float scale;
+        if (!parseSize(&p, &width, &height) || !parseScale(&p, &scale) || (*p && *p != ',')) {
+            fprintf(stderr, "Invalid synthetic layout: %s, expected WIDTHxHEIGHT[@SCALE][,WIDTHxHEIGHT[@SCALE]...]\n", opts->layout);
+            return -1;
+        }
+        if (*p == ',') ++p;
+
+        ScreenshotContext *ctx = &ctxArray[count];
+        *ctx = (ScreenshotContext){
+            .size = (size_t)width * height * 4,
+            .format = SCREENSHOT_FORMAT_RGBA,
+            .posx = posx,
+            .width = width,
+            .height = height,
+            .scale = scale,
+            .isPrimary = count == 0,
+        };
+        if (sink->begin(sink->user, count, ctx)) return -1;
+
+        size_t bandSize = (size_t)width * SCREENSHOT_BAND_HEIGHT * 4;
+        unsigned char *band = malloc(bandSize);
+        if (band == NULL) {
+            fprintf(stderr, "Failed to alloc memory for band\n");
+            return -1;
+        }
+        addMemStat(MEM_STAGE_BAND, bandSize);
+
+        int ret = 0;
+        for (int y = 0; !ret && y < height; y += SCREENSHOT_BAND_HEIGHT) {
+            int rows = height - y < SCREENSHOT_BAND_HEIGHT ? height - y : SCREENSHOT_BAND_HEIGHT;
+            drawTestPattern(band, width, height, y, rows, (int)count);
+            ret = sink->band(sink->user, count, y, rows, band);
+        }
+
+        subMemStat(MEM_STAGE_BAND, bandSize);
+        free(band);
+        if (ret) return -1;
+        posx += (int)(width / scale);
+    }
+    return (int)count;
+}
+
+const ScreenshotBackend fileScreenshotBackend = {
+    .name = "file",
+    .description = "load images from --input, raw pixels when --layout is given",
+    .fallback = false,
+    .probe = probeFile,
+    .capture = captureScreenshotFile,
+    .release = releaseScreenshot,
+    .captureBands = captureScreenshotBandsFile,
+};
+
+const ScreenshotBackend syntheticScreenshotBackend = {
+    .name = "synthetic",
+    .description = "generated test pattern, geometry from --layout (default " SYNTHETIC_DEFAULT_LAYOUT ")",
+    .fallback = false,
+    .probe = probeSynthetic,
+    .capture = captureScreenshotSynthetic,
+    .release = releaseScreenshot,
+    .captureBands = captureScreenshotBandsSynthetic,
+};
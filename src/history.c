@@ -0,0 +1,445 @@
+#include "history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HISTORY_SLOT_COUNT 8
+#define HISTORY_BAND_HEIGHT 64 /* rows per deflate stream, bounds work per step */
+#define HISTORY_MAGIC "ZMFYHST2"
+#define MAX_PATH_LENGTH 4096
+
+/*
+ * Slot file layout, native endian as it never leaves the machine:
+ * header, screenCount screen records, all band records in screen order,
+ * then the deflated bands.
+ */
+typedef struct HistoryFileHeader {
+    char magic[8];
+    uint64_t sequence;
+    int64_t timestamp;
+    uint32_t screenCount;
+    uint32_t bandHeight;
+} HistoryFileHeader;
+
+typedef struct HistoryScreenRecord {
+    int32_t posx;
+    int32_t posy;
+    uint32_t width;
+    uint32_t height;
+    float scale;
+    uint32_t isPrimary;
+    uint32_t bandCount;
+} HistoryScreenRecord;
+
+typedef struct HistoryBandRecord {
+    uint64_t offset;
+    uint64_t size;
+} HistoryBandRecord;
+
+typedef struct HistoryEntry {
+    int slot;
+    uint64_t sequence;
+} HistoryEntry;
+
+typedef struct HistorySaveJob {
+    int slot;
+    uint64_t sequence;
+    size_t count;
+    Image images[SCREENSHOT_MAX_COUNT]; /* owned copies */
+    ScreenshotContext geometry[SCREENSHOT_MAX_COUNT];
+} HistorySaveJob;
+
+static struct HistoryContext {
+    bool initialized;
+    char dir[MAX_PATH_LENGTH];
+
+    /* saved snapshots, newest first, guarded by lock as saver appends */
+    HistoryEntry entries[HISTORY_SLOT_COUNT];
+    size_t count;
+    uint64_t nextSequence;
+    uint64_t displayedSequence;
+    pthread_mutex_t lock;
+
+    pthread_t saver;
+    bool saverStarted;
+    HistorySaveJob *job;
+
+    /* snapshot being restored */
+    const unsigned char *map;
+    size_t mapSize;
+    const HistoryFileHeader *header;
+    const HistoryScreenRecord *screens;
+    const HistoryBandRecord *bands;
+    size_t screen;
+    size_t band;
+    size_t bandIdx; /* index into bands across screens */
+} historyCtx = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static void getSlotPath(int slot, const char *suffix, char *path, size_t size) {
+    snprintf(path, size, "%s/snapshot-%d.%s", historyCtx.dir, slot, suffix);
+}
+
+/* captures may show anything on screen, keep them private to the user */
+static int makeDirectory(const char *path) {
+    if (mkdir(path, 0700) && errno != EEXIST) {
+        TraceLog(LOG_WARNING, "history: failed to create directory %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int resolveCacheDirectory(void) {
+    const char *cache = getenv("XDG_CACHE_HOME");
+    char base[MAX_PATH_LENGTH - sizeof("/zoomify")];
+
+    if (cache && *cache) {
+        snprintf(base, sizeof(base), "%s", cache);
+    } else {
+        const char *home = getenv("HOME");
+        if (home == NULL || *home == '\0') return -1;
+        snprintf(base, sizeof(base), "%s/.cache", home);
+    }
+    if (makeDirectory(base)) return -1;
+    snprintf(historyCtx.dir, sizeof(historyCtx.dir), "%s/zoomify", base);
+    if (makeDirectory(historyCtx.dir)) return -1;
+    /* tighten a directory left by older versions */
+    chmod(historyCtx.dir, 0700);
+    return 0;
+}
+
+/* validate a mapped slot file, tables are only touched after this passed */
+static bool checkSnapshot(const unsigned char *map, size_t size) {
+    if (size < sizeof(HistoryFileHeader)) return false;
+    const HistoryFileHeader *header = (const HistoryFileHeader *)map;
+    if (memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) || header->bandHeight == 0 ||
+        header->screenCount == 0 || header->screenCount > SCREENSHOT_MAX_COUNT) {
+        return false;
+    }
+
+    size_t offset = sizeof(HistoryFileHeader) + header->screenCount * sizeof(HistoryScreenRecord);
+    if (offset > size) return false;
+    const HistoryScreenRecord *screens = (const HistoryScreenRecord *)(map + sizeof(HistoryFileHeader));
+    size_t bandCount = 0;
+    for (uint32_t i = 0; i < header->screenCount; ++i) {
+        if (screens[i].bandCount != (screens[i].height + header->bandHeight - 1) / header->bandHeight) return false;
+        bandCount += screens[i].bandCount;
+    }
+
+    const HistoryBandRecord *bands = (const HistoryBandRecord *)(map + offset);
+    if (offset + bandCount * sizeof(HistoryBandRecord) > size) return false;
+    for (size_t i = 0; i < bandCount; ++i) {
+        if (bands[i].offset > size || bands[i].size > size - bands[i].offset || bands[i].size > INT32_MAX) return false;
+    }
+    return true;
+}
+
+static int compareEntries(const void *a, const void *b) {
+    uint64_t sa = ((const HistoryEntry *)a)->sequence, sb = ((const HistoryEntry *)b)->sequence;
+    return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+int initHistory(void) {
+    if (historyCtx.initialized) return 0;
+    if (resolveCacheDirectory()) return -1;
+
+    /* only headers are read, pixels stay on disk until restored */
+    for (int slot = 0; slot < HISTORY_SLOT_COUNT; ++slot) {
+        char path[MAX_PATH_LENGTH + 32];
+        getSlotPath(slot, "bin", path, sizeof(path));
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) continue;
+
+        HistoryFileHeader header;
+        if (fread(&header, sizeof(header), 1, fp) == 1 && !memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic))) {
+            historyCtx.entries[historyCtx.count++] = (HistoryEntry){slot, header.sequence};
+            if (header.sequence >= historyCtx.nextSequence) historyCtx.nextSequence = header.sequence + 1;
+        }
+        fclose(fp);
+    }
+    qsort(historyCtx.entries, historyCtx.count, sizeof(HistoryEntry), compareEntries);
+
+    historyCtx.initialized = true;
+    TraceLog(LOG_INFO, "history: %zu snapshots in %s", historyCtx.count, historyCtx.dir);
+    return 0;
+}
+
+static void releaseSaveJob(HistorySaveJob *job) {
+    if (job == NULL) return;
+    for (size_t i = 0; i < job->count; ++i) {
+        UnloadImage(job->images[i]);
+    }
+    free(job);
+}
+
+static void waitHistorySaver(void) {
+    if (!historyCtx.saverStarted) return;
+    pthread_join(historyCtx.saver, NULL);
+    historyCtx.saverStarted = false;
+    releaseSaveJob(historyCtx.job);
+    historyCtx.job = NULL;
+}
+
+void unloadHistory(void) {
+    cancelHistoryRestore();
+    waitHistorySaver();
+}
+
+static bool writeSnapshot(HistorySaveJob *job, FILE *fp) {
+    HistoryFileHeader header = {
+        .sequence = job->sequence,
+        .timestamp = (int64_t)time(NULL),
+        .screenCount = (uint32_t)job->count,
+        .bandHeight = HISTORY_BAND_HEIGHT,
+    };
+    memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+
+    HistoryScreenRecord screens[SCREENSHOT_MAX_COUNT];
+    size_t bandCount = 0;
+    for (size_t i = 0; i < job->count; ++i) {
+        screens[i] = (HistoryScreenRecord){
+            .posx = job->geometry[i].posx,
+            .posy = job->geometry[i].posy,
+            .width = (uint32_t)job->images[i].width,
+            .height = (uint32_t)job->images[i].height,
+            .scale = job->geometry[i].scale,
+            .isPrimary = job->geometry[i].isPrimary,
+            .bandCount = (uint32_t)((job->images[i].height + HISTORY_BAND_HEIGHT - 1) / HISTORY_BAND_HEIGHT),
+        };
+        bandCount += screens[i].bandCount;
+    }
+
+    HistoryBandRecord *bands = calloc(bandCount, sizeof(HistoryBandRecord));
+    if (bands == NULL) return false;
+
+    /* band table is written once all band sizes are known */
+    uint64_t offset = sizeof(header) + job->count * sizeof(HistoryScreenRecord) + bandCount * sizeof(HistoryBandRecord);
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(screens, sizeof(HistoryScreenRecord), job->count, fp) == job->count &&
+              fseek(fp, (long)offset, SEEK_SET) == 0;
+
+    for (size_t i = 0, b = 0; ok && i < job->count; ++i) {
+        const Image *image = &job->images[i];
+        size_t stride = (size_t)image->width * 4;
+        for (int y = 0; ok && y < image->height; y += HISTORY_BAND_HEIGHT, ++b) {
+            int rows = image->height - y < HISTORY_BAND_HEIGHT ? image->height - y : HISTORY_BAND_HEIGHT;
+            int size = 0;
+            unsigned char *data = CompressData((unsigned char *)image->data + (size_t)y * stride, (int)(stride * rows), &size);
+            ok = data && fwrite(data, 1, (size_t)size, fp) == (size_t)size;
+            bands[b] = (HistoryBandRecord){offset, (uint64_t)size};
+            offset += (uint64_t)size;
+            MemFree(data);
+        }
+    }
+
+    ok = ok && fseek(fp, (long)(sizeof(header) + job->count * sizeof(HistoryScreenRecord)), SEEK_SET) == 0 &&
+         fwrite(bands, sizeof(HistoryBandRecord), bandCount, fp) == bandCount;
+    free(bands);
+    return ok;
+}
+
+static void *saveSnapshot(void *arg) {
+    HistorySaveJob *job = arg;
+    char tmpPath[MAX_PATH_LENGTH + 32], path[MAX_PATH_LENGTH + 32];
+    getSlotPath(job->slot, "tmp", tmpPath, sizeof(tmpPath));
+    getSlotPath(job->slot, "bin", path, sizeof(path));
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    FILE *fp = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (fp == NULL) {
+        TraceLog(LOG_WARNING, "history: failed to open %s", tmpPath);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    bool ok = writeSnapshot(job, fp);
+    ok = fclose(fp) == 0 && ok;
+
+    /* rename keeps a slot that is being restored intact, its mapping holds the old inode */
+    if (!ok || rename(tmpPath, path)) {
+        TraceLog(LOG_WARNING, "history: failed to write %s", path);
+        unlink(tmpPath);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&historyCtx.lock);
+    if (historyCtx.count == HISTORY_SLOT_COUNT) historyCtx.count--;
+    memmove(historyCtx.entries + 1, historyCtx.entries, historyCtx.count * sizeof(HistoryEntry));
+    historyCtx.entries[0] = (HistoryEntry){job->slot, job->sequence};
+    historyCtx.count++;
+    pthread_mutex_unlock(&historyCtx.lock);
+    return NULL;
+}
+
+int saveHistorySnapshot(const Image *images, const ScreenshotContext *geometry, size_t count) {
+    if (!historyCtx.initialized || count == 0 || count > SCREENSHOT_MAX_COUNT) return -1;
+    waitHistorySaver();
+
+    HistorySaveJob *job = calloc(1, sizeof(HistorySaveJob));
+    if (job == NULL) return -1;
+    for (size_t i = 0; i < count; ++i) {
+        job->images[i] = ImageCopy(images[i]);
+        job->geometry[i] = geometry[i];
+        job->geometry[i].data = NULL;
+        job->count++;
+        if (job->images[i].data == NULL) {
+            releaseSaveJob(job);
+            return -1;
+        }
+    }
+
+    /* reuse the oldest slot once the ring is full, entries only change on this thread or in saver */
+    job->slot = (int)historyCtx.count;
+    if (historyCtx.count == HISTORY_SLOT_COUNT) {
+        job->slot = historyCtx.entries[HISTORY_SLOT_COUNT - 1].slot;
+    } else {
+        bool used[HISTORY_SLOT_COUNT] = {0};
+        for (size_t i = 0; i < historyCtx.count; ++i) used[historyCtx.entries[i].slot] = true;
+        for (job->slot = 0; used[job->slot]; ++job->slot);
+    }
+    job->sequence = historyCtx.nextSequence++;
+    historyCtx.displayedSequence = job->sequence;
+
+    if (pthread_create(&historyCtx.saver, NULL, saveSnapshot, job)) {
+        TraceLog(LOG_WARNING, "history: failed to start saver thread");
+        releaseSaveJob(job);
+        return -1;
+    }
+    historyCtx.saverStarted = true;
+    historyCtx.job = job;
+    return 0;
+}
+
+size_t getHistoryCount(void) {
+    pthread_mutex_lock(&historyCtx.lock);
+    size_t count = historyCtx.count;
+    pthread_mutex_unlock(&historyCtx.lock);
+    return count;
+}
+
+int getHistoryPosition(void) {
+    int position = -1;
+    pthread_mutex_lock(&historyCtx.lock);
+    for (size_t i = 0; i < historyCtx.count; ++i) {
+        if (historyCtx.entries[i].sequence == historyCtx.displayedSequence) position = (int)i;
+    }
+    pthread_mutex_unlock(&historyCtx.lock);
+    return position;
+}
+
+int beginHistoryRestore(int position, ScreenshotContext *geometry, size_t capacity) {
+    cancelHistoryRestore();
+
+    pthread_mutex_lock(&historyCtx.lock);
+    bool valid = position >= 0 && (size_t)position < historyCtx.count;
+    HistoryEntry entry = valid ? historyCtx.entries[position] : (HistoryEntry){0};
+    pthread_mutex_unlock(&historyCtx.lock);
+    if (!valid) return -1;
+
+    char path[MAX_PATH_LENGTH + 32];
+    getSlotPath(entry.slot, "bin", path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "history: failed to open %s", path);
+        return -1;
+    }
+    struct stat st;
+    void *map = fstat(fd, &st) ? MAP_FAILED : mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        TraceLog(LOG_WARNING, "history: failed to map %s", path);
+        return -1;
+    }
+
+    historyCtx.map = map;
+    historyCtx.mapSize = (size_t)st.st_size;
+    if (!checkSnapshot(map, historyCtx.mapSize) || ((const HistoryFileHeader *)map)->screenCount > capacity) {
+        TraceLog(LOG_WARNING, "history: %s is corrupted", path);
+        cancelHistoryRestore();
+        return -1;
+    }
+
+    historyCtx.header = map;
+    historyCtx.screens = (const HistoryScreenRecord *)(historyCtx.map + sizeof(HistoryFileHeader));
+    historyCtx.bands = (const HistoryBandRecord *)(historyCtx.screens + historyCtx.header->screenCount);
+    historyCtx.screen = historyCtx.band = historyCtx.bandIdx = 0;
+    historyCtx.displayedSequence = entry.sequence;
+    /* bands are consumed front to back once */
+    madvise(map, historyCtx.mapSize, MADV_SEQUENTIAL);
+
+    for (uint32_t i = 0; i < historyCtx.header->screenCount; ++i) {
+        geometry[i] = (ScreenshotContext){
+            .format = SCREENSHOT_FORMAT_RGBA,
+            .posx = historyCtx.screens[i].posx,
+            .posy = historyCtx.screens[i].posy,
+            .width = historyCtx.screens[i].width,
+            .height = historyCtx.screens[i].height,
+            .size = (size_t)historyCtx.screens[i].width * historyCtx.screens[i].height * 4,
+            .scale = historyCtx.screens[i].scale,
+            .isPrimary = historyCtx.screens[i].isPrimary,
+        };
+    }
+    return (int)historyCtx.header->screenCount;
+}
+
+bool nextHistoryBand(Image *images, size_t count, HistoryBand *band) {
+    if (historyCtx.map == NULL) return false;
+
+    while (historyCtx.screen < historyCtx.header->screenCount &&
+           historyCtx.band == historyCtx.screens[historyCtx.screen].bandCount) {
+        historyCtx.screen++;
+        historyCtx.band = 0;
+    }
+    if (historyCtx.screen >= historyCtx.header->screenCount) {
+        cancelHistoryRestore();
+        return false;
+    }
+
+    const HistoryScreenRecord *screen = &historyCtx.screens[historyCtx.screen];
+    const HistoryBandRecord *record = &historyCtx.bands[historyCtx.bandIdx];
+    Image *image = historyCtx.screen < count ? &images[historyCtx.screen] : NULL;
+    if (image == NULL || image->width != (int)screen->width || image->height != (int)screen->height) {
+        TraceLog(LOG_WARNING, "history: screen %zu doesn't match restored geometry", historyCtx.screen);
+        cancelHistoryRestore();
+        return false;
+    }
+
+    int y = (int)(historyCtx.band * historyCtx.header->bandHeight);
+    int rows = (int)screen->height - y < (int)historyCtx.header->bandHeight ? (int)screen->height - y : (int)historyCtx.header->bandHeight;
+    size_t expected = (size_t)screen->width * rows * 4;
+    int size = 0;
+    unsigned char *data = DecompressData(historyCtx.map + record->offset, (int)record->size, &size);
+    if (data == NULL || (size_t)size != expected) {
+        TraceLog(LOG_WARNING, "history: band %zu of screen %zu is corrupted", historyCtx.band, historyCtx.screen);
+        MemFree(data);
+        cancelHistoryRestore();
+        return false;
+    }
+    memcpy((unsigned char *)image->data + (size_t)y * screen->width * 4, data, expected);
+    MemFree(data);
+
+    *band = (HistoryBand){historyCtx.screen, y, rows};
+    historyCtx.band++;
+    historyCtx.bandIdx++;
+    return true;
+}
+
+void cancelHistoryRestore(void) {
+    if (historyCtx.map) munmap((void *)historyCtx.map, historyCtx.mapSize);
+    historyCtx.map = NULL;
+    historyCtx.mapSize = 0;
+    historyCtx.header = NULL;
+    historyCtx.screens = NULL;
+    historyCtx.bands = NULL;
+}
+
+bool isHistoryRestoring(void) {
+    return historyCtx.map != NULL;
+}
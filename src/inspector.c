@@ -0,0 +1,180 @@
+#include "inspector.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memstat.h"
+
+/*
+ * Tables are kept in uint32 and rely on wrap-around arithmetic: a region sum
+ * is exact as long as the true sum fits, i.e. region area <= this many pixels.
+ * Bigger regions are split into row bands.
+ */
+#define INSPECTOR_MAX_AREA ((size_t)(UINT32_MAX / 255u))
+
+typedef struct SummedAreaTable {
+    uint32_t *sums; /* (width + 1) * (height + 1) entries of r, g, b */
+    int width;
+    int height;
+} SummedAreaTable;
+
+static struct InspectorContext {
+    Image *images; /* shallow copies, pixel data is not owned */
+    SummedAreaTable *tables;
+    size_t count;
+    pthread_t worker;
+    bool workerStarted;
+    atomic_int state; /* InspectorState */
+    atomic_bool cancel;
+} inspectorCtx = {0};
+
+static void *buildTables([[maybe_unused]] void *arg) {
+    for (size_t i = 0; i < inspectorCtx.count; ++i) {
+        const Image *image = &inspectorCtx.images[i];
+        SummedAreaTable *table = &inspectorCtx.tables[i];
+        size_t stride = (size_t)image->width + 1;
+
+        table->sums = calloc(stride * ((size_t)image->height + 1) * 3, sizeof(uint32_t));
+        if (table->sums == NULL) {
+            TraceLog(LOG_WARNING, "failed to alloc summed-area table for screenshot %zu", i);
+            atomic_store(&inspectorCtx.state, INSPECTOR_FAILED);
+            return NULL;
+        }
+        table->width = image->width;
+        table->height = image->height;
+        addMemStat(MEM_STAGE_INSPECTOR, stride * ((size_t)image->height + 1) * 3 * sizeof(uint32_t));
+
+        const unsigned char *pixels = image->data;
+        for (int y = 0; y < image->height; ++y) {
+            if (atomic_load_explicit(&inspectorCtx.cancel, memory_order_relaxed)) {
+                atomic_store(&inspectorCtx.state, INSPECTOR_IDLE);
+                return NULL;
+            }
+
+            uint32_t rowSum[3] = {0};
+            const uint32_t *above = table->sums + (size_t)y * stride * 3;
+            uint32_t *row = table->sums + ((size_t)y + 1) * stride * 3;
+            const unsigned char *px = pixels + (size_t)y * image->width * 4;
+
+            for (int x = 0; x < image->width; ++x, px += 4) {
+                for (int c = 0; c < 3; ++c) {
+                    rowSum[c] += px[c];
+                    row[(x + 1) * 3 + c] = above[(x + 1) * 3 + c] + rowSum[c];
+                }
+            }
+        }
+    }
+
+    atomic_store(&inspectorCtx.state, INSPECTOR_READY);
+    return NULL;
+}
+
+int startInspectorTables(const Image *images, size_t count) {
+    releaseInspectorTables();
+
+    for (size_t i = 0; i < count; ++i) {
+        if (images[i].format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+            TraceLog(LOG_WARNING, "inspector requires RGBA8 images");
+            atomic_store(&inspectorCtx.state, INSPECTOR_FAILED);
+            return -1;
+        }
+    }
+
+    inspectorCtx.tables = calloc(count, sizeof(SummedAreaTable));
+    inspectorCtx.images = malloc(count * sizeof(Image));
+    if (inspectorCtx.tables == NULL || inspectorCtx.images == NULL) {
+        releaseInspectorTables();
+        atomic_store(&inspectorCtx.state, INSPECTOR_FAILED);
+        return -1;
+    }
+    memcpy(inspectorCtx.images, images, count * sizeof(Image));
+    inspectorCtx.count = count;
+    atomic_store(&inspectorCtx.state, INSPECTOR_BUILDING);
+    atomic_store(&inspectorCtx.cancel, false);
+
+    if (pthread_create(&inspectorCtx.worker, NULL, buildTables, NULL)) {
+        TraceLog(LOG_WARNING, "failed to start inspector worker thread");
+        atomic_store(&inspectorCtx.state, INSPECTOR_FAILED);
+        return -1;
+    }
+    inspectorCtx.workerStarted = true;
+    return 0;
+}
+
+bool isInspectorReady(void) {
+    return atomic_load(&inspectorCtx.state) == INSPECTOR_READY;
+}
+
+InspectorState getInspectorState(void) {
+    return (InspectorState)atomic_load(&inspectorCtx.state);
+}
+
+void releaseInspectorTables(void) {
+    if (inspectorCtx.workerStarted) {
+        atomic_store(&inspectorCtx.cancel, true);
+        pthread_join(inspectorCtx.worker, NULL);
+    }
+    for (size_t i = 0; inspectorCtx.tables && i < inspectorCtx.count; ++i) {
+        const SummedAreaTable *table = &inspectorCtx.tables[i];
+        if (table->sums) subMemStat(MEM_STAGE_INSPECTOR, ((size_t)table->width + 1) * ((size_t)table->height + 1) * 3 * sizeof(uint32_t));
+        free(table->sums);
+    }
+    free(inspectorCtx.tables);
+    free(inspectorCtx.images);
+    memset(&inspectorCtx, 0, sizeof(inspectorCtx));
+}
+
+bool getInspectorPixel(size_t idx, int x, int y, Color *color) {
+    if (idx >= inspectorCtx.count) return false;
+    const Image *image = &inspectorCtx.images[idx];
+    if (x < 0 || y < 0 || x >= image->width || y >= image->height) return false;
+
+    const unsigned char *px = (const unsigned char *)image->data + ((size_t)y * image->width + x) * 4;
+    *color = (Color){px[0], px[1], px[2], px[3]};
+    return true;
+}
+
+static void sumRect(const SummedAreaTable *table, int x0, int y0, int x1, int y1, uint64_t sum[3]) {
+    size_t stride = (size_t)table->width + 1;
+    const uint32_t *a = table->sums + ((size_t)y0 * stride + x0) * 3;
+    const uint32_t *b = table->sums + ((size_t)y0 * stride + x1) * 3;
+    const uint32_t *c = table->sums + ((size_t)y1 * stride + x0) * 3;
+    const uint32_t *d = table->sums + ((size_t)y1 * stride + x1) * 3;
+
+    for (int i = 0; i < 3; ++i) {
+        sum[i] += (uint32_t)(d[i] - b[i] - c[i] + a[i]);
+    }
+}
+
+bool getInspectorRegionStats(size_t idx, Rectangle region, InspectorStats *stats) {
+    if (!isInspectorReady() || idx >= inspectorCtx.count) return false;
+    const SummedAreaTable *table = &inspectorCtx.tables[idx];
+
+    int x0 = (int)region.x, y0 = (int)region.y;
+    int x1 = (int)(region.x + region.width), y1 = (int)(region.y + region.height);
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > table->width) x1 = table->width;
+    if (y1 > table->height) y1 = table->height;
+    if (x0 >= x1 || y0 >= y1) return false;
+
+    uint64_t sum[3] = {0};
+    int bandRows = (int)(INSPECTOR_MAX_AREA / (size_t)(x1 - x0));
+    for (int y = y0; y < y1; y += bandRows) {
+        sumRect(table, x0, y, x1, y + bandRows < y1 ? y + bandRows : y1, sum);
+    }
+
+    size_t count = (size_t)(x1 - x0) * (size_t)(y1 - y0);
+    stats->pixelCount = count;
+    stats->average = (Color){
+        (unsigned char)(sum[0] / count),
+        (unsigned char)(sum[1] / count),
+        (unsigned char)(sum[2] / count),
+        255,
+    };
+    stats->luminance = (0.2126f * sum[0] + 0.7152f * sum[1] + 0.0722f * sum[2]) / (float)count;
+    return true;
+}
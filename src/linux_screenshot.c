@@ -4,8 +4,17 @@
 #include <stdlib.h>
 #include <string.h>
 
-// raylib is compiled with stb_image_write.h, thus there's no need to include
-extern unsigned char *stbi_write_png_to_mem(const unsigned char *pixels, int stride_bytes, int x, int y, int n, int *out_len);
+#include "memstat.h"
+
+#if defined(X11) || defined(WAYLAND)
+static void releaseScreenshot(ScreenshotContext *context_array, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (context_array[i].data) subMemStat(MEM_STAGE_CONTEXT, context_array[i].size);
+        free(context_array[i].data);
+        context_array[i].data = NULL;
+    }
+}
+#endif
 
 #ifdef X11
 #include <X11/X.h>
@@ -13,16 +22,45 @@ extern unsigned char *stbi_write_png_to_mem(const unsigned char *pixels, int str
 #include <X11/Xutil.h>
 #include <X11/extensions/Xinerama.h>
 
-ScreenshotContext *captureScreenshotX11(size_t *count) {
+static bool probeX11([[maybe_unused]] const ScreenshotOptions *opts) {
+    return getenv("DISPLAY") != NULL;
+}
+
+static XImage *getImageX11(Display *display, Window root, int x, int y, int width, int height) {
+    XImage *image = XGetImage(display, root, x, y, width, height, AllPlanes, ZPixmap);
+    if (image) addMemStat(MEM_STAGE_CAPTURE, (size_t)image->bytes_per_line * image->height);
+    return image;
+}
+
+static void destroyImageX11(XImage *image) {
+    subMemStat(MEM_STAGE_CAPTURE, (size_t)image->bytes_per_line * image->height);
+    XDestroyImage(image);
+}
+
+// convert XImage to RGBA
+static void convertImageX11(XImage *image, unsigned char *rgba_data, int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            long pixel = XGetPixel(image, x, y);
+            rgba_data[(y * width + x) * 4 + 0] = (pixel & image->red_mask) >> 16;   // R
+            rgba_data[(y * width + x) * 4 + 1] = (pixel & image->green_mask) >> 8;  // G
+            rgba_data[(y * width + x) * 4 + 2] = (pixel & image->blue_mask);        // B
+            rgba_data[(y * width + x) * 4 + 3] = 255;                               // A
+        }
+    }
+}
+
+static int captureScreenshotX11([[maybe_unused]] const ScreenshotOptions *opts, ScreenshotContext *context_array, size_t capacity) {
     Display *display;
     Window root;
     XImage *image;
     int x, y, width, height;
+    int i = 0;
 
     display = XOpenDisplay(NULL);
     if (display == NULL) {
         fprintf(stderr, "Failed to open display\n");
-        return NULL;
+        return -1;
     }
 
     int scr_cnt;
@@ -31,10 +69,12 @@ ScreenshotContext *captureScreenshotX11(size_t *count) {
         fprintf(stderr, "Failed to query screens: Xinerama is not active\n");
         goto query_screen_failed;
     }
-    ScreenshotContext *context_array = malloc(scr_cnt * sizeof(ScreenshotContext));
-    *count = scr_cnt;
+    if ((size_t)scr_cnt > capacity) {
+        fprintf(stderr, "Too many screens (%d), capturing first %zu\n", scr_cnt, capacity);
+        scr_cnt = (int)capacity;
+    }
 
-    for (int i = 0; i < scr_cnt; ++i) {
+    for (i = 0; i < scr_cnt; ++i) {
         x = scr_info[i].x_org;
         y = scr_info[i].y_org;
         width = scr_info[i].width;
@@ -42,7 +82,7 @@ ScreenshotContext *captureScreenshotX11(size_t *count) {
         fprintf(stderr, "screen %d: (%d, %d) %dx%d\n", i, x, y, width, height);
 
         root = DefaultRootWindow(display);
-        image = XGetImage(display, root, x, y, width, height, AllPlanes, ZPixmap);
+        image = getImageX11(display, root, x, y, width, height);
         if (image == NULL) {
             fprintf(stderr, "Failed to get image\n");
             goto get_image_failed;
@@ -54,55 +94,129 @@ ScreenshotContext *captureScreenshotX11(size_t *count) {
             fprintf(stderr, "Failed to alloc memory for rgba_data\n");
             goto alloc_rgba_failed;
         }
+        addMemStat(MEM_STAGE_CONTEXT, rgba_size);
+        convertImageX11(image, rgba_data, width, height);
 
-        // convert XImage to RGBA
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                long pixel = XGetPixel(image, x, y);
-                rgba_data[(y * width + x) * 4 + 0] = (pixel & image->red_mask) >> 16;   // R
-                rgba_data[(y * width + x) * 4 + 1] = (pixel & image->green_mask) >> 8;  // G
-                rgba_data[(y * width + x) * 4 + 2] = (pixel & image->blue_mask);        // B
-                rgba_data[(y * width + x) * 4 + 3] = 255;                               // A
-            }
-        }
-
-        // convert RGBA to PNG format byte array
-        int png_size;
-        unsigned char *png_data = stbi_write_png_to_mem(rgba_data, width * 4, width, height, 4, &png_size);
-        if (png_data == NULL) {
-            fprintf(stderr, "Failed to convert rgba to png\n");
-            goto convert_png_failed;
-        }
-        context_array[i].data = png_data;
-        context_array[i].size = (size_t)png_size;
+        // hand over raw RGBA, encoding to PNG only to decode it again is wasted work
+        context_array[i].data = rgba_data;
+        context_array[i].size = rgba_size;
+        context_array[i].format = SCREENSHOT_FORMAT_RGBA;
         context_array[i].width = width;
         context_array[i].height = height;
         context_array[i].posx = x;
         context_array[i].posy = y;
+        context_array[i].scale = 1.0f; // xinerama geometry is in pixels
         context_array[i].isPrimary = !scr_info[i].screen_number;
 
         // free memory
-        free(rgba_data);
-        XDestroyImage(image);
+        destroyImageX11(image);
     }
 
     XFree(scr_info);
     XCloseDisplay(display);
-    return context_array;
+    return scr_cnt;
 
-convert_png_failed:
 alloc_rgba_failed:
-    XDestroyImage(image);
+    destroyImageX11(image);
 get_image_failed:
-    XCloseDisplay(display);
+    releaseScreenshot(context_array, i);
+    XFree(scr_info);
 query_screen_failed:
+    XCloseDisplay(display);
+    return -1;
+}
+
+/*
+ * Grab and convert one band of rows at a time, so neither a full screen
+ * XImage nor a full screen RGBA buffer is ever allocated.
+ */
+static int captureScreenshotBandsX11([[maybe_unused]] const ScreenshotOptions *opts, ScreenshotContext *context_array,
+                                     size_t capacity, const ScreenshotBandSink *sink) {
+    int count = -1;
+
+    Display *display = XOpenDisplay(NULL);
+    if (display == NULL) {
+        fprintf(stderr, "Failed to open display\n");
+        return -1;
+    }
+    Window root = DefaultRootWindow(display);
+
+    int scr_cnt;
+    XineramaScreenInfo *scr_info = XineramaQueryScreens(display, &scr_cnt);
+    if (scr_info == NULL) {
+        fprintf(stderr, "Failed to query screens: Xinerama is not active\n");
+        goto query_screen_failed;
+    }
+    if ((size_t)scr_cnt > capacity) {
+        fprintf(stderr, "Too many screens (%d), capturing first %zu\n", scr_cnt, capacity);
+        scr_cnt = (int)capacity;
+    }
+
+    for (int i = 0; i < scr_cnt; ++i) {
+        int width = scr_info[i].width, height = scr_info[i].height;
+        ScreenshotContext *ctx = &context_array[i];
+        *ctx = (ScreenshotContext){
+            .size = (size_t)width * height * 4,
+            .format = SCREENSHOT_FORMAT_RGBA,
+            .posx = scr_info[i].x_org,
+            .posy = scr_info[i].y_org,
+            .width = width,
+            .height = height,
+            .scale = 1.0f,
+            .isPrimary = !scr_info[i].screen_number,
+        };
+        if (sink->begin(sink->user, i, ctx)) goto sink_failed;
+
+        size_t band_size = (size_t)width * SCREENSHOT_BAND_HEIGHT * 4;
+        unsigned char *band = malloc(band_size);
+        if (band == NULL) {
+            fprintf(stderr, "Failed to alloc memory for band\n");
+            goto sink_failed;
+        }
+        addMemStat(MEM_STAGE_BAND, band_size);
+
+        bool ok = true;
+        for (int y = 0; ok && y < height; y += SCREENSHOT_BAND_HEIGHT) {
+            int rows = height - y < SCREENSHOT_BAND_HEIGHT ? height - y : SCREENSHOT_BAND_HEIGHT;
+            XImage *image = getImageX11(display, root, ctx->posx, ctx->posy + y, width, rows);
+            if (image == NULL) {
+                fprintf(stderr, "Failed to get image\n");
+                ok = false;
+                break;
+            }
+            convertImageX11(image, band, width, rows);
+            destroyImageX11(image);
+            ok = !sink->band(sink->user, i, y, rows, band);
+        }
+
+        subMemStat(MEM_STAGE_BAND, band_size);
+        free(band);
+        if (!ok) goto sink_failed;
+    }
+    count = scr_cnt;
+
+sink_failed:
     XFree(scr_info);
-    return NULL;
+query_screen_failed:
+    XCloseDisplay(display);
+    return count;
 }
+
+const ScreenshotBackend x11ScreenshotBackend = {
+    .name = "x11",
+    .description = "X11 root window via XGetImage, one screenshot per Xinerama screen",
+    .fallback = true,
+    .probe = probeX11,
+    .capture = captureScreenshotX11,
+    .release = releaseScreenshot,
+    .captureBands = captureScreenshotBandsX11,
+};
 #endif  // X11
 
 #ifdef WAYLAND
 #include <dbus/dbus.h>
+#include <limits.h>
+#include <stdint.h>
 #include <wayland-client.h>
 
 // Display info part of wayland implementation uses code from
@@ -147,6 +261,7 @@ typedef struct WaylandDisplayInfo {
     int y;
     int width;
     int height;
+    int scale;
 } WaylandDisplayInfo;
 
 struct wl_display_context {
@@ -159,6 +274,7 @@ struct output_t {
     int y;
     int width;
     int height;
+    int scale;
     struct wl_display_context *ctx;
     struct wl_output *output;
     struct wl_list link;
@@ -184,7 +300,10 @@ static void output_handle_mode(void *data, [[maybe_unused]] struct wl_output *wl
 
 static void output_handle_done([[maybe_unused]] void *data, [[maybe_unused]] struct wl_output *wl_output) {}
 
-static void output_handle_scale([[maybe_unused]] void *data, [[maybe_unused]] struct wl_output *wl_output, [[maybe_unused]] int32_t scale) {}
+static void output_handle_scale(void *data, [[maybe_unused]] struct wl_output *wl_output, int32_t scale) {
+    struct output_t *out = (struct output_t *)data;
+    out->scale = scale;
+}
 
 static void output_handle_description([[maybe_unused]] void *data, [[maybe_unused]] struct wl_output *wl_output, [[maybe_unused]] const char *description) {}
 
@@ -207,7 +326,10 @@ static void global_registry_handler(void *data, struct wl_registry *registry,
         struct output_t *output = malloc(sizeof(struct output_t));
         output->ctx = ctx;
         output->id = id;
-        output->output = wl_registry_bind(registry, id, &wl_output_interface, version);
+        // 1 is the default for wl_output v1, from v2 on the scale event is sent on bind
+        output->scale = 1;
+        // listener above knows events up to v4
+        output->output = wl_registry_bind(registry, id, &wl_output_interface, version < 4 ? version : 4);
         wl_list_insert(&ctx->outputs, &output->link);
         wl_output_add_listener(output->output, &output_listener, output);
     }
@@ -220,7 +342,7 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = global_registry_remover,
 };
 
-WaylandDisplayInfo *getDisplayInfo() {
+WaylandDisplayInfo *getDisplayInfo(int *count) {
     struct wl_display *display;
     struct wl_registry *registry;
     struct wl_display_context ctx;
@@ -246,14 +368,18 @@ WaylandDisplayInfo *getDisplayInfo() {
     int len = wl_list_length(&ctx.outputs);
     printf("screen count: %d\n", len);
     int i = 0;
-    infos = (WaylandDisplayInfo *)malloc(sizeof(WaylandDisplayInfo) * len);
+    if (len > 0) infos = (WaylandDisplayInfo *)malloc(sizeof(WaylandDisplayInfo) * len);
+    *count = infos ? len : 0;
     wl_list_for_each_safe(out, tmp, &ctx.outputs, link) {
-        infos[i].id = out->id;
-        infos[i].width = out->width;
-        infos[i].height = out->height;
-        infos[i].x = out->x;
-        infos[i].y = out->y;
-        printf("id: %d, width: %d, height: %d, x: %d, y: %d\n", out->id, out->width, out->height, out->x, out->y);
+        if (infos) {
+            infos[i].id = out->id;
+            infos[i].width = out->width;
+            infos[i].height = out->height;
+            infos[i].x = out->x;
+            infos[i].y = out->y;
+            infos[i].scale = out->scale;
+        }
+        printf("id: %d, width: %d, height: %d, x: %d, y: %d, scale: %d\n", out->id, out->width, out->height, out->x, out->y, out->scale);
         wl_output_destroy(out->output);
         wl_list_remove(&out->link);
         free(out);
@@ -267,6 +393,15 @@ connect_wayland_display_failed:
     return infos;
 }
 
+// width & height from the IHDR chunk, which comes first in every PNG file
+static bool readPngSize(const unsigned char *buf, long size, uint32_t *width, uint32_t *height) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (size < 24 || memcmp(buf, signature, sizeof(signature)) || memcmp(buf + 12, "IHDR", 4)) return false;
+    *width = (uint32_t)buf[16] << 24 | (uint32_t)buf[17] << 16 | (uint32_t)buf[18] << 8 | buf[19];
+    *height = (uint32_t)buf[20] << 24 | (uint32_t)buf[21] << 16 | (uint32_t)buf[22] << 8 | buf[23];
+    return *width > 0 && *height > 0;
+}
+
 /*
  * @brief Take screenshot via xdg-desktop-portal through dbus
  * org.freedesktop.impl.portal.Screenshot.Screenshot
@@ -283,17 +418,24 @@ connect_wayland_display_failed:
  *   results a{sv}
  * )
  **/
-ScreenshotContext *captureScreenshotWayland(size_t *count) {
+static bool probeWayland([[maybe_unused]] const ScreenshotOptions *opts) {
+    const char *session_type = getenv("XDG_SESSION_TYPE");
+    return getenv("WAYLAND_DISPLAY") != NULL || (session_type != NULL && !strcmp(session_type, "wayland"));
+}
+
+static int captureScreenshotWayland([[maybe_unused]] const ScreenshotOptions *opts, ScreenshotContext *context_array, size_t capacity) {
     DBusError error;
     DBusConnection *conn;
     DBusMessageIter args_iter, options_iter, entries_iter, variants_iter, reply_iter, response_iter, response_dict_iter, screenshot_uri_value_iter;
     const char *key, *screenshot_uri_value = "", *handle;
-    ScreenshotContext *screenshot_context = NULL;
+    int count = -1;
     FILE *fp;
     long nbytes;
-    *count = 0;
 
-    WaylandDisplayInfo *display_infos = getDisplayInfo();
+    if (capacity < 1) return -1;
+
+    int display_count = 0;
+    WaylandDisplayInfo *display_infos = getDisplayInfo(&display_count);
     if (display_infos == NULL) {
         fprintf(stderr, "Failed to get wayland display info");
         goto get_display_info_failed;
@@ -435,18 +577,42 @@ ScreenshotContext *captureScreenshotWayland(size_t *count) {
     /* read screenshot into memory & delete file */
     unsigned char *buf = malloc(sizeof(unsigned char) * nbytes);
     fread(buf, sizeof(unsigned char), nbytes, fp);
+    addMemStat(MEM_STAGE_CONTEXT, nbytes);
     fclose(fp);
     remove(screenshot_uri_value);
 
-    screenshot_context = malloc(sizeof(ScreenshotContext));
-    screenshot_context->posx = display_infos[0].x;
-    screenshot_context->posy = display_infos[0].y;
-    screenshot_context->width = display_infos[0].width;
-    screenshot_context->height = display_infos[0].height;
-    screenshot_context->data = buf;
-    screenshot_context->size = nbytes;
-    screenshot_context->isPrimary = true;
-    *count = 1;
+    /*
+     * Portal returns one image of the whole desktop, so it is a single screen spanning
+     * every output. Output positions are logical, modes are pixels, and logical sizes
+     * come from the integer wl_output scale: compositors report fractional scales
+     * rounded up, so a fractionally scaled layout comes out too small.
+     */
+    uint32_t png_width, png_height;
+    if (!readPngSize(buf, nbytes, &png_width, &png_height)) {
+        fprintf(stderr, "Portal screenshot is not a PNG file\n");
+        subMemStat(MEM_STAGE_CONTEXT, nbytes);
+        free(buf);
+        goto open_file_failed;
+    }
+    int left = INT_MAX, top = INT_MAX, right = INT_MIN;
+    for (int i = 0; i < display_count; ++i) {
+        int scale = display_infos[i].scale > 0 ? display_infos[i].scale : 1;
+        if (display_infos[i].x < left) left = display_infos[i].x;
+        if (display_infos[i].y < top) top = display_infos[i].y;
+        if (display_infos[i].x + display_infos[i].width / scale > right) right = display_infos[i].x + display_infos[i].width / scale;
+    }
+
+    context_array[0].posx = left;
+    context_array[0].posy = top;
+    context_array[0].width = png_width;
+    context_array[0].height = png_height;
+    // pixels per logical point over the whole desktop
+    context_array[0].scale = right > left ? (float)png_width / (float)(right - left) : 1.0f;
+    context_array[0].data = buf;
+    context_array[0].size = nbytes;
+    context_array[0].format = SCREENSHOT_FORMAT_PNG;
+    context_array[0].isPrimary = true;
+    count = 1;
 
 open_file_failed:
 unexpected_response_type:
@@ -458,30 +624,17 @@ send_dbus_request_failed:
 create_message_failed:
 connect_dbus_failed:
     dbus_error_free(&error);
+    free(display_infos);
 get_display_info_failed:
-    return screenshot_context;
+    return count;
 }
-#endif  // Wayland
 
-ScreenshotContext *captureScreenshot(size_t *count) {
-    char *XDG_SESSION_TYPE = getenv("XDG_SESSION_TYPE");
-    if (!strcmp(XDG_SESSION_TYPE, "wayland")) {
-#ifdef WAYLAND
-        return captureScreenshotWayland(count);
-#endif
-        fprintf(stderr,
-                "You are using a binary that not build with Wayland support,\n"
-                "try rebuild it without specifying DISPLAY_PROTOCOL environment variable\n");
-        return NULL;
-    }
-    if (!strcmp(XDG_SESSION_TYPE, "x11")) {
-#ifdef X11
-        return captureScreenshotX11(count);
-#endif
-        fprintf(stderr,
-                "You are using a binary that not build with X11 support,\n"
-                "try rebuild it without specifying DISPLAY_PROTOCOL environment variable\n");
-        return NULL;
-    }
-    return NULL;
-}
+const ScreenshotBackend waylandScreenshotBackend = {
+    .name = "wayland",
+    .description = "xdg-desktop-portal Screenshot interface through dbus",
+    .fallback = true,
+    .probe = probeWayland,
+    .capture = captureScreenshotWayland,
+    .release = releaseScreenshot,
+};
+#endif  // Wayland
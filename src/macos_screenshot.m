@@ -1,4 +1,5 @@
 #import "macos_screenshot.h"
+#import "memstat.h"
 #import <CoreGraphics/CGImage.h>
 #import <ScreenCaptureKit/ScreenCaptureKit.h>
 #import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
@@ -11,6 +12,7 @@
 @property NSInteger posy;
 @property size_t width;
 @property size_t height;
+@property float scale;
 @property bool isPrimary;
 
 @end
@@ -25,12 +27,19 @@
         self.posy = 0;
         self.width = 0;
         self.height = 0;
+        self.scale = 1.0f;
         self.isPrimary = false;
     }
     return self;
 }
 
-- (instancetype)initWithData:(NSMutableData *)data posX:(NSInteger)x posY:(NSInteger)y width:(size_t)w height:(size_t)h isPrimary:(bool)primary {
+- (instancetype)initWithData:(NSMutableData *)data
+                        posX:(NSInteger)x
+                        posY:(NSInteger)y
+                       width:(size_t)w
+                      height:(size_t)h
+                       scale:(float)s
+                   isPrimary:(bool)primary {
     self = [super init];
     if (self) {
         _data = data;
@@ -38,6 +47,7 @@
         _posy = y;
         _width = w;
         _height = h;
+        _scale = s;
         _isPrimary = primary;
     }
     return self;
@@ -67,7 +77,21 @@
 }
 @end
 
-ScreenshotContext *captureScreenshot(size_t *count) {
+static bool probeMacOS(const ScreenshotOptions *opts) {
+    (void)opts;
+    return [[NSScreen screens] count] > 0;
+}
+
+static void releaseScreenshotMacOS(ScreenshotContext *contextArray, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (contextArray[i].data) subMemStat(MEM_STAGE_CONTEXT, contextArray[i].size);
+        free(contextArray[i].data);
+        contextArray[i].data = NULL;
+    }
+}
+
+static int captureScreenshotMacOS(const ScreenshotOptions *opts, ScreenshotContext *contextArray, size_t capacity) {
+    (void)opts;
     __block NSMutableArray<INScreenshotContext *> *ctxArray = [NSMutableArray array];
     __block bool done = false;
     NSArray<NSScreen *> *screens = [NSScreen screens];
@@ -139,6 +163,7 @@ ScreenshotContext *captureScreenshot(size_t *count) {
                                      posY:screen.frame.origin.y
                                     width:CGImageGetWidth(sampleBuffer)
                                    height:CGImageGetHeight(sampleBuffer)
+                                    scale:filter.pointPixelScale
                                 isPrimary:[NSScreen mainScreen] == screen];
                          [ctxArray addObject:ctx];
                          NSLog(@"%ld, %ld", ctx.width, ctx.height);
@@ -154,22 +179,34 @@ ScreenshotContext *captureScreenshot(size_t *count) {
         [NSThread sleepForTimeInterval:0.01];
     }
 
-    *count = [ctxArray count];
-    if (!*count) return NULL;
+    size_t count = [ctxArray count];
+    if (!count) return -1;
+    if (count > capacity) count = capacity;
 
-    ScreenshotContext *contextArray = malloc(*count * sizeof(ScreenshotContext));
-    for (size_t i = 0; i < *count; ++i) {
+    for (size_t i = 0; i < count; ++i) {
         size_t length = [ctxArray[i].data length];
         // copy screenshot image data to c array
         contextArray[i].data = malloc(length);
         memcpy(contextArray[i].data, [ctxArray[i].data bytes], length);
+        addMemStat(MEM_STAGE_CONTEXT, length);
         contextArray[i].posx = (int)ctxArray[i].posx;
         contextArray[i].posy = (int)ctxArray[i].posy;
         contextArray[i].width = ctxArray[i].width;
         contextArray[i].height = ctxArray[i].height;
+        contextArray[i].scale = ctxArray[i].scale;
         contextArray[i].isPrimary = ctxArray[i].isPrimary;
         contextArray[i].size = length;
+        contextArray[i].format = SCREENSHOT_FORMAT_PNG;
     }
 
-    return contextArray;
+    return (int)count;
 }
+
+const ScreenshotBackend macosScreenshotBackend = {
+    .name = "macos",
+    .description = "ScreenCaptureKit SCScreenshotManager, one screenshot per display",
+    .fallback = true,
+    .probe = probeMacOS,
+    .capture = captureScreenshotMacOS,
+    .release = releaseScreenshotMacOS,
+};
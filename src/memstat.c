@@ -0,0 +1,77 @@
+#include "memstat.h"
+
+#include <raylib.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+#define MB(bytes) ((double)(bytes) / (1024.0 * 1024.0))
+
+static struct MemStatContext {
+    atomic_size_t current[MEM_STAGE_COUNT];
+    atomic_size_t peak[MEM_STAGE_COUNT];
+    atomic_size_t totalCurrent;
+    atomic_size_t totalPeak;
+} memStatCtx = {0};
+
+static void updatePeak(atomic_size_t *peak, size_t value) {
+    size_t old = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > old && !atomic_compare_exchange_weak_explicit(peak, &old, value, memory_order_relaxed, memory_order_relaxed));
+}
+
+void addMemStat(MemStage stage, size_t bytes) {
+    size_t current = atomic_fetch_add_explicit(&memStatCtx.current[stage], bytes, memory_order_relaxed) + bytes;
+    size_t total = atomic_fetch_add_explicit(&memStatCtx.totalCurrent, bytes, memory_order_relaxed) + bytes;
+    updatePeak(&memStatCtx.peak[stage], current);
+    updatePeak(&memStatCtx.totalPeak, total);
+}
+
+void subMemStat(MemStage stage, size_t bytes) {
+    atomic_fetch_sub_explicit(&memStatCtx.current[stage], bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&memStatCtx.totalCurrent, bytes, memory_order_relaxed);
+}
+
+MemStageStats getMemStat(MemStage stage) {
+    return (MemStageStats){
+        atomic_load_explicit(&memStatCtx.current[stage], memory_order_relaxed),
+        atomic_load_explicit(&memStatCtx.peak[stage], memory_order_relaxed),
+    };
+}
+
+MemStageStats getMemStatTotal(void) {
+    return (MemStageStats){
+        atomic_load_explicit(&memStatCtx.totalCurrent, memory_order_relaxed),
+        atomic_load_explicit(&memStatCtx.totalPeak, memory_order_relaxed),
+    };
+}
+
+const char *getMemStageName(MemStage stage) {
+    static const char *names[MEM_STAGE_COUNT] = {
+        [MEM_STAGE_CAPTURE] = "capture",
+        [MEM_STAGE_CONTEXT] = "context",
+        [MEM_STAGE_BAND] = "band",
+        [MEM_STAGE_IMAGE] = "image",
+        [MEM_STAGE_TEXTURE] = "texture",
+        [MEM_STAGE_INSPECTOR] = "inspector",
+    };
+    return stage < MEM_STAGE_COUNT ? names[stage] : "unknown";
+}
+
+size_t getPeakRSS(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss; /* bytes on macOS */
+#else
+    return (size_t)usage.ru_maxrss * 1024; /* kilobytes on Linux */
+#endif
+}
+
+void logMemStats(const char *when) {
+    MemStageStats total = getMemStatTotal();
+    TraceLog(LOG_WARNING, "memory %s: peak rss %.1f MB, pipeline %.1f MB (peak %.1f MB)",
+             when, MB(getPeakRSS()), MB(total.current), MB(total.peak));
+    for (int i = 0; i < MEM_STAGE_COUNT; ++i) {
+        MemStageStats stats = getMemStat(i);
+        TraceLog(LOG_WARNING, "    %-10s %8.1f MB (peak %.1f MB)", getMemStageName(i), MB(stats.current), MB(stats.peak));
+    }
+}
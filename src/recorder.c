@@ -0,0 +1,423 @@
+#include "recorder.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <raylib.h>
+#include <rlgl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define RECORDER_PBO_COUNT 10        /* frames in flight between GPU and encoder */
+#define RECORDER_DRAIN_TIMEOUT 1e9   /* ns to wait for outstanding readbacks when stopping */
+#define RECORDER_FILE_BUFFER (8 << 20)
+
+/*
+ * rlgl does not expose pixel buffer objects nor sync objects, the entry points
+ * are core since GL 3.2 and resolved through GLFW, which raylib links in.
+ */
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef unsigned int GLbitfield;
+typedef int GLint;
+typedef int GLsizei;
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+typedef uint64_t GLuint64;
+typedef struct __GLsync *GLsync;
+
+#define GL_RGBA 0x1908
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_MAP_READ_BIT 0x0001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_CONDITION_SATISFIED 0x911C
+
+typedef void (*GLFWglproc)(void);
+extern GLFWglproc glfwGetProcAddress(const char *procname);
+
+static struct RecorderGL {
+    bool loaded;
+    void (*GenBuffers)(GLsizei n, GLuint *buffers);
+    void (*DeleteBuffers)(GLsizei n, const GLuint *buffers);
+    void (*BindBuffer)(GLenum target, GLuint buffer);
+    void (*BufferData)(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+    void *(*MapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    unsigned char (*UnmapBuffer)(GLenum target);
+    void (*ReadPixels)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels);
+    GLsync (*FenceSync)(GLenum condition, GLbitfield flags);
+    GLenum (*ClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    void (*DeleteSync)(GLsync sync);
+} gl = {0};
+
+static struct RecorderContext {
+    bool active;
+    bool qoi; /* image sequence instead of y4m stream */
+    char path[1024];
+    FILE *fp;
+    int width;
+    int height;
+    size_t frameSize; /* RGBA8 bytes of one frame */
+
+    /*
+     * Readback ring of running frame counters, slot of frame n is n % RECORDER_PBO_COUNT.
+     * Frames released .. encoded - 1 are done & wait for unmap, encoded .. mapped - 1 are
+     * mapped & owned by encoder, mapped .. issued - 1 are waiting for GPU. Buffers stay
+     * mapped while encoding, pixels are never copied on the render thread.
+     */
+    GLuint pbo[RECORDER_PBO_COUNT];
+    GLsync fence[RECORDER_PBO_COUNT];
+    double issueTime[RECORDER_PBO_COUNT];
+    const unsigned char *mappedPixels[RECORDER_PBO_COUNT]; /* NULL when readback was dropped */
+    size_t issued;
+    size_t mapped;   /* guarded by lock */
+    size_t encoded;  /* guarded by lock */
+    size_t released;
+    unsigned char *scratch; /* encoder only, yuv planes or flipped rgba */
+    pthread_t encoder;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool stop;
+    bool failed; /* a write failed, encoder discards the rest & recording stops */
+
+    RecorderStats stats; /* guarded by lock */
+    double latencySum;
+    size_t latencyCount;
+} recorderCtx = {0};
+
+static bool loadRecorderGL(void) {
+    if (gl.loaded) return true;
+
+#define LOAD_GL_PROC(name)                                       \
+    do {                                                         \
+        *(GLFWglproc *)&gl.name = glfwGetProcAddress("gl" #name); \
+        if (gl.name == NULL) {                                   \
+            TraceLog(LOG_WARNING, "recorder: missing gl" #name); \
+            return false;                                        \
+        }                                                        \
+    } while (0)
+
+    LOAD_GL_PROC(GenBuffers);
+    LOAD_GL_PROC(DeleteBuffers);
+    LOAD_GL_PROC(BindBuffer);
+    LOAD_GL_PROC(BufferData);
+    LOAD_GL_PROC(MapBufferRange);
+    LOAD_GL_PROC(UnmapBuffer);
+    LOAD_GL_PROC(ReadPixels);
+    LOAD_GL_PROC(FenceSync);
+    LOAD_GL_PROC(ClientWaitSync);
+    LOAD_GL_PROC(DeleteSync);
+#undef LOAD_GL_PROC
+
+    gl.loaded = true;
+    return true;
+}
+
+/*
+ * Full range BT.601 with 2x2 averaged chroma, rgba is bottom-up as read from
+ * the framebuffer so rows are flipped on the way.
+ */
+static void convertFrameYUV420(const unsigned char *rgba, unsigned char *yuv, int width, int height) {
+    size_t stride = (size_t)width * 4;
+    unsigned char *yPlane = yuv;
+    unsigned char *uPlane = yPlane + (size_t)width * height;
+    unsigned char *vPlane = uPlane + (size_t)width * height / 4;
+
+    for (int y = 0; y < height; y += 2) {
+        const unsigned char *row0 = rgba + (size_t)(height - 1 - y) * stride;
+        const unsigned char *row1 = row0 - stride;
+        unsigned char *luma0 = yPlane + (size_t)y * width;
+        unsigned char *luma1 = luma0 + width;
+        unsigned char *u = uPlane + (size_t)(y / 2) * (width / 2);
+        unsigned char *v = vPlane + (size_t)(y / 2) * (width / 2);
+
+        for (int x = 0; x < width; x += 2) {
+            const unsigned char *px[4] = {row0 + x * 4, row0 + x * 4 + 4, row1 + x * 4, row1 + x * 4 + 4};
+            unsigned char *out[4] = {luma0 + x, luma0 + x + 1, luma1 + x, luma1 + x + 1};
+            int r = 0, g = 0, b = 0;
+
+            for (int k = 0; k < 4; ++k) {
+                *out[k] = (unsigned char)((77 * px[k][0] + 150 * px[k][1] + 29 * px[k][2] + 128) >> 8);
+                r += px[k][0];
+                g += px[k][1];
+                b += px[k][2];
+            }
+            r = (r + 2) >> 2;
+            g = (g + 2) >> 2;
+            b = (b + 2) >> 2;
+            *u++ = (unsigned char)((-43 * r - 85 * g + 128 * b + 32895) >> 8);
+            *v++ = (unsigned char)((128 * r - 107 * g - 21 * b + 32895) >> 8);
+        }
+    }
+}
+
+static bool writeFrame(const unsigned char *rgba, size_t index) {
+    int width = recorderCtx.width, height = recorderCtx.height;
+
+    if (recorderCtx.qoi) {
+        size_t stride = (size_t)width * 4;
+        for (int y = 0; y < height; ++y) {
+            memcpy(recorderCtx.scratch + (size_t)y * stride, rgba + (size_t)(height - 1 - y) * stride, stride);
+        }
+        Image image = {
+            .data = recorderCtx.scratch,
+            .width = width,
+            .height = height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+        char path[sizeof(recorderCtx.path) + 32];
+        snprintf(path, sizeof(path), "%s/frame-%06zu.qoi", recorderCtx.path, index);
+        return ExportImage(image, path);
+    }
+
+    size_t yuvSize = (size_t)width * height * 3 / 2;
+    convertFrameYUV420(rgba, recorderCtx.scratch, width, height);
+    return fputs("FRAME\n", recorderCtx.fp) >= 0 && fwrite(recorderCtx.scratch, 1, yuvSize, recorderCtx.fp) == yuvSize;
+}
+
+static void *encodeFrames([[maybe_unused]] void *arg) {
+    size_t index = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&recorderCtx.lock);
+        while (recorderCtx.encoded == recorderCtx.mapped && !recorderCtx.stop) {
+            pthread_cond_wait(&recorderCtx.cond, &recorderCtx.lock);
+        }
+        if (recorderCtx.encoded == recorderCtx.mapped) {
+            pthread_mutex_unlock(&recorderCtx.lock);
+            break;
+        }
+        const unsigned char *frame = recorderCtx.mappedPixels[recorderCtx.encoded % RECORDER_PBO_COUNT];
+        bool failed = recorderCtx.failed;
+        pthread_mutex_unlock(&recorderCtx.lock);
+
+        /* keep draining the ring after a failure, so the render thread gets its buffers back */
+        bool written = frame && !failed && writeFrame(frame, index);
+        if (frame && !failed && !written) {
+            TraceLog(LOG_WARNING, "recorder: failed to write frame %zu to %s, stopping", index, recorderCtx.path);
+        }
+        if (frame) index++;
+
+        pthread_mutex_lock(&recorderCtx.lock);
+        recorderCtx.encoded++;
+        if (written) {
+            recorderCtx.stats.framesWritten++;
+        } else if (frame && !failed) {
+            recorderCtx.stats.writeErrors++;
+            recorderCtx.failed = true;
+        } else if (frame) {
+            recorderCtx.stats.droppedEncoder++;
+        }
+        pthread_mutex_unlock(&recorderCtx.lock);
+    }
+    return NULL;
+}
+
+/* unmap buffers the encoder is done with, they can take new readbacks */
+static void releaseEncodedFrames(void) {
+    pthread_mutex_lock(&recorderCtx.lock);
+    size_t encoded = recorderCtx.encoded;
+    pthread_mutex_unlock(&recorderCtx.lock);
+
+    for (; recorderCtx.released < encoded; recorderCtx.released++) {
+        size_t slot = recorderCtx.released % RECORDER_PBO_COUNT;
+        if (recorderCtx.mappedPixels[slot] == NULL) continue;
+        gl.BindBuffer(GL_PIXEL_PACK_BUFFER, recorderCtx.pbo[slot]);
+        gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        recorderCtx.mappedPixels[slot] = NULL;
+    }
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/* map every readback the GPU has finished, oldest first, or all of them if drain */
+static void collectReadbacks(bool drain) {
+    while (recorderCtx.mapped < recorderCtx.issued) {
+        size_t slot = recorderCtx.mapped % RECORDER_PBO_COUNT;
+        GLenum status = gl.ClientWaitSync(recorderCtx.fence[slot],
+                                          drain ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                          drain ? (GLuint64)RECORDER_DRAIN_TIMEOUT : 0);
+        bool signaled = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+        if (!signaled && !drain) break;
+
+        const unsigned char *pixels = NULL;
+        double latency = (GetTime() - recorderCtx.issueTime[slot]) * 1000.0;
+        if (signaled) {
+            gl.BindBuffer(GL_PIXEL_PACK_BUFFER, recorderCtx.pbo[slot]);
+            pixels = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)recorderCtx.frameSize, GL_MAP_READ_BIT);
+            gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        } else {
+            TraceLog(LOG_WARNING, "recorder: readback timed out, frame dropped");
+        }
+        gl.DeleteSync(recorderCtx.fence[slot]);
+        recorderCtx.fence[slot] = NULL;
+        recorderCtx.mappedPixels[slot] = pixels;
+
+        /* encoder takes the mapped buffer as is, a failed map passes as a dropped frame */
+        pthread_mutex_lock(&recorderCtx.lock);
+        recorderCtx.mapped++;
+        if (pixels) {
+            recorderCtx.stats.framesCaptured++;
+            recorderCtx.latencySum += latency;
+            recorderCtx.latencyCount++;
+            if (latency > recorderCtx.stats.maxLatencyMs) recorderCtx.stats.maxLatencyMs = latency;
+        } else {
+            recorderCtx.stats.droppedReadback++;
+        }
+        pthread_cond_signal(&recorderCtx.cond);
+        pthread_mutex_unlock(&recorderCtx.lock);
+    }
+}
+
+static void releaseRecorder(void) {
+    if (recorderCtx.fp) fclose(recorderCtx.fp);
+    recorderCtx.fp = NULL;
+    if (recorderCtx.pbo[0]) gl.DeleteBuffers(RECORDER_PBO_COUNT, recorderCtx.pbo);
+    memset(recorderCtx.pbo, 0, sizeof(recorderCtx.pbo));
+    free(recorderCtx.scratch);
+    recorderCtx.scratch = NULL;
+}
+
+int startRecording(const char *path, int width, int height, int fps) {
+    stopRecording();
+    if (!loadRecorderGL()) return -1;
+
+    /* 4:2:0 chroma needs even dimensions, drop the odd top row / right column */
+    recorderCtx.width = width & ~1;
+    recorderCtx.height = height & ~1;
+    recorderCtx.frameSize = (size_t)recorderCtx.width * recorderCtx.height * 4;
+    recorderCtx.qoi = !IsFileExtension(path, ".y4m");
+    snprintf(recorderCtx.path, sizeof(recorderCtx.path), "%s", path);
+    recorderCtx.issued = recorderCtx.mapped = recorderCtx.encoded = recorderCtx.released = 0;
+    recorderCtx.stop = false;
+    recorderCtx.failed = false;
+    recorderCtx.stats = (RecorderStats){0};
+    recorderCtx.latencySum = 0.0;
+    recorderCtx.latencyCount = 0;
+
+    if (recorderCtx.width <= 0 || recorderCtx.height <= 0) {
+        TraceLog(LOG_WARNING, "recorder: invalid frame size %dx%d", width, height);
+        return -1;
+    }
+
+    if (recorderCtx.qoi) {
+        if (mkdir(path, 0755) && errno != EEXIST) {
+            TraceLog(LOG_WARNING, "recorder: failed to create directory %s", path);
+            return -1;
+        }
+    } else {
+        recorderCtx.fp = fopen(path, "wb");
+        if (recorderCtx.fp == NULL) {
+            TraceLog(LOG_WARNING, "recorder: failed to open %s", path);
+            return -1;
+        }
+        setvbuf(recorderCtx.fp, NULL, _IOFBF, RECORDER_FILE_BUFFER);
+        fprintf(recorderCtx.fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", recorderCtx.width, recorderCtx.height, fps);
+    }
+
+    recorderCtx.scratch = malloc(recorderCtx.frameSize);
+    if (recorderCtx.scratch == NULL) goto alloc_failed;
+
+    gl.GenBuffers(RECORDER_PBO_COUNT, recorderCtx.pbo);
+    for (size_t i = 0; i < RECORDER_PBO_COUNT; ++i) {
+        gl.BindBuffer(GL_PIXEL_PACK_BUFFER, recorderCtx.pbo[i]);
+        gl.BufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)recorderCtx.frameSize, NULL, GL_STREAM_READ);
+    }
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_init(&recorderCtx.lock, NULL);
+    pthread_cond_init(&recorderCtx.cond, NULL);
+    if (pthread_create(&recorderCtx.encoder, NULL, encodeFrames, NULL)) {
+        TraceLog(LOG_WARNING, "recorder: failed to start encoder thread");
+        pthread_cond_destroy(&recorderCtx.cond);
+        pthread_mutex_destroy(&recorderCtx.lock);
+        releaseRecorder();
+        return -1;
+    }
+
+    recorderCtx.active = true;
+    TraceLog(LOG_INFO, "recorder: %dx%d@%d to %s", recorderCtx.width, recorderCtx.height, fps, path);
+    return 0;
+
+alloc_failed:
+    TraceLog(LOG_WARNING, "recorder: failed to alloc frame buffers");
+    releaseRecorder();
+    return -1;
+}
+
+void captureRecordingFrame(void) {
+    if (!recorderCtx.active) return;
+
+    /* disk full or path gone, nothing later will be written either */
+    pthread_mutex_lock(&recorderCtx.lock);
+    bool failed = recorderCtx.failed;
+    pthread_mutex_unlock(&recorderCtx.lock);
+    if (failed) {
+        stopRecording();
+        return;
+    }
+
+    /* flush batched draws, readback must see the whole frame */
+    rlDrawRenderBatchActive();
+    releaseEncodedFrames();
+    collectReadbacks(false);
+
+    if (recorderCtx.issued - recorderCtx.released == RECORDER_PBO_COUNT) {
+        /* whole ring busy, never wait on GPU or encoder, blame whichever holds more of it */
+        pthread_mutex_lock(&recorderCtx.lock);
+        if (recorderCtx.mapped - recorderCtx.released > recorderCtx.issued - recorderCtx.mapped) {
+            recorderCtx.stats.droppedEncoder++;
+        } else {
+            recorderCtx.stats.droppedReadback++;
+        }
+        pthread_mutex_unlock(&recorderCtx.lock);
+        return;
+    }
+
+    size_t slot = recorderCtx.issued % RECORDER_PBO_COUNT;
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, recorderCtx.pbo[slot]);
+    gl.ReadPixels(0, 0, recorderCtx.width, recorderCtx.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    recorderCtx.fence[slot] = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    recorderCtx.issueTime[slot] = GetTime();
+    recorderCtx.issued++;
+}
+
+void stopRecording(void) {
+    if (!recorderCtx.active) return;
+
+    collectReadbacks(true);
+
+    pthread_mutex_lock(&recorderCtx.lock);
+    recorderCtx.stop = true;
+    pthread_cond_broadcast(&recorderCtx.cond);
+    pthread_mutex_unlock(&recorderCtx.lock);
+    pthread_join(recorderCtx.encoder, NULL);
+    releaseEncodedFrames();
+    pthread_cond_destroy(&recorderCtx.cond);
+    pthread_mutex_destroy(&recorderCtx.lock);
+
+    releaseRecorder();
+    recorderCtx.active = false;
+
+    RecorderStats stats = getRecorderStats();
+    TraceLog(LOG_WARNING, "recorder: %zu frames written to %s, dropped %zu on readback, %zu on encoder, %zu write errors, latency avg %.1f ms max %.1f ms",
+             stats.framesWritten, recorderCtx.path, stats.droppedReadback, stats.droppedEncoder, stats.writeErrors, stats.avgLatencyMs, stats.maxLatencyMs);
+}
+
+bool isRecording(void) {
+    return recorderCtx.active;
+}
+
+RecorderStats getRecorderStats(void) {
+    if (recorderCtx.active) pthread_mutex_lock(&recorderCtx.lock);
+    RecorderStats stats = recorderCtx.stats;
+    if (recorderCtx.latencyCount) stats.avgLatencyMs = recorderCtx.latencySum / (double)recorderCtx.latencyCount;
+    if (recorderCtx.active) pthread_mutex_unlock(&recorderCtx.lock);
+    return stats;
+}
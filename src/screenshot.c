@@ -0,0 +1,96 @@
+#include "screenshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "file_screenshot.h"
+
+#if defined(__APPLE__)
+#include "macos_screenshot.h"
+#elif defined(__linux__)
+#include "linux_screenshot.h"
+#endif
+
+/* order matters, fallback chain is walked from top to bottom */
+static const ScreenshotBackend *const screenshotBackends[] = {
+#if defined(__APPLE__)
+    &macosScreenshotBackend,
+#endif
+#ifdef WAYLAND
+    &waylandScreenshotBackend,
+#endif
+#ifdef X11
+    &x11ScreenshotBackend,
+#endif
+    &fileScreenshotBackend,
+    &syntheticScreenshotBackend,
+};
+
+#define SCREENSHOT_BACKEND_COUNT (sizeof(screenshotBackends) / sizeof(screenshotBackends[0]))
+
+const ScreenshotBackend *const *getScreenshotBackends(size_t *count) {
+    *count = SCREENSHOT_BACKEND_COUNT;
+    return screenshotBackends;
+}
+
+const ScreenshotBackend *findScreenshotBackend(const char *name) {
+    for (size_t i = 0; i < SCREENSHOT_BACKEND_COUNT; ++i) {
+        if (!strcmp(screenshotBackends[i]->name, name)) return screenshotBackends[i];
+    }
+    return NULL;
+}
+
+static int captureWithBackend(const ScreenshotBackend *b, const ScreenshotOptions *opts,
+                              ScreenshotContext *ctxArray, size_t capacity, const ScreenshotBandSink *sink) {
+    for (size_t i = 0; i < capacity; ++i) {
+        ctxArray[i].data = NULL;
+    }
+    if (sink && b->captureBands) return b->captureBands(opts, ctxArray, capacity, sink);
+    if (sink) fprintf(stderr, "Screenshot backend %s can't stream bands, capturing whole frames\n", b->name);
+    return b->capture(opts, ctxArray, capacity);
+}
+
+static int captureScreenshotWith(const char *name, const ScreenshotOptions *opts,
+                                 ScreenshotContext *ctxArray, size_t capacity,
+                                 const ScreenshotBandSink *sink, const ScreenshotBackend **backend) {
+    if (name) {
+        const ScreenshotBackend *b = findScreenshotBackend(name);
+        if (b == NULL) {
+            fprintf(stderr, "Unknown screenshot backend: %s\n", name);
+            return -1;
+        }
+        if (!b->probe(opts)) {
+            fprintf(stderr, "Screenshot backend %s is not available\n", name);
+            return -1;
+        }
+        *backend = b;
+        return captureWithBackend(b, opts, ctxArray, capacity, sink);
+    }
+
+    for (size_t i = 0; i < SCREENSHOT_BACKEND_COUNT; ++i) {
+        const ScreenshotBackend *b = screenshotBackends[i];
+        if (!b->fallback || !b->probe(opts)) continue;
+
+        int count = captureWithBackend(b, opts, ctxArray, capacity, sink);
+        if (count > 0) {
+            *backend = b;
+            return count;
+        }
+        fprintf(stderr, "Screenshot backend %s failed, trying next one\n", b->name);
+    }
+
+    fprintf(stderr, "No screenshot backend available, try --backend\n");
+    return -1;
+}
+
+int captureScreenshot(const char *name, const ScreenshotOptions *opts,
+                      ScreenshotContext *ctxArray, size_t capacity,
+                      const ScreenshotBackend **backend) {
+    return captureScreenshotWith(name, opts, ctxArray, capacity, NULL, backend);
+}
+
+int captureScreenshotBands(const char *name, const ScreenshotOptions *opts,
+                           ScreenshotContext *ctxArray, size_t capacity,
+                           const ScreenshotBandSink *sink, const ScreenshotBackend **backend) {
+    return captureScreenshotWith(name, opts, ctxArray, capacity, sink, backend);
+}
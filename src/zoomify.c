@@ -1,113 +1,275 @@
+#include <float.h>
+#include <getopt.h>
 #include <limits.h>
 #include <raylib.h>
 #include <raymath.h>
+#include <rlgl.h>
 #include <shaders.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
-#if defined(__APPLE__)
-#include "macos_screenshot.h"
-#elif defined(__linux__)
-#include "linux_screenshot.h"
-#endif
+#include "annotation.h"
+#include "history.h"
+#include "inspector.h"
+#include "memstat.h"
+#include "recorder.h"
+#include "screenshot.h"
 
 #define ZOOM_MIN ((float)0.01f)
 #define ZOOM_MAX ((float)100.0f)
+#define CAMERA_STEP ((double)1.0 / 240.0)    /* fixed simulation step, independent of render rate */
+#define CAMERA_ZOOM_OMEGA ((float)14.0f)     /* angular frequency of zoom spring, 1/s */
+#define CAMERA_ZOOM_EPSILON ((float)1e-3f)   /* log zoom distance considered converged */
+#define CAMERA_PAN_FRICTION ((float)5.0f)    /* decay rate of pan inertia, 1/s */
+#define CAMERA_PAN_SAMPLE_TAU ((float)0.05f) /* smoothing of drag velocity, seconds */
+#define CAMERA_PAN_STOP_SPEED ((float)10.0f) /* screen pixels per second, inertia stops below */
+#define MAX_FRAME_TIME ((float)0.1f)         /* longer frames are dropped rather than caught up */
 #define SPL_RADIUS_MIN ((float)1.0f)
 #define SPL_RADIUS_MAX ((float)1000.0f)
 #define SPL_OPACITY_MIN ((float)0.0f)
 #define SPL_OPACITY_MAX ((float)0.9f)
+#define SPL_MAX_COUNT SPOTLIGHT_SHADER_MAX_SPOTLIGHTS
+#define SPL_FEATHER ((float)8.0f)
+#define SPL_ASPECT ((float)1.6f)
+#define LENS_MAGNIFICATION_MIN ((float)1.0f)
+#define LENS_MAGNIFICATION_MAX ((float)32.0f)
+#define LENS_RADIUS_MIN ((float)20.0f)
+#define LENS_RADIUS_MAX ((float)1000.0f)
+#define ANNOTATION_THICK ((float)4.0f)
+#define ANNOTATION_COLOR RED
+#define ERASER_RADIUS ((float)12.0f)
+#define GRID_FADE_START ((float)CANVAS_SHADER_GRID_FADE_START) /* screen pixels per texel */
+#define LENS_MAX_SCREENS CANVAS_SHADER_LENS_MAX_SCREENS
+#define RULER_THICK 20
+#define RULER_LABEL_WIDTH 44              /* left ruler fits 5 digit labels */
+#define RULER_TICK_SPACING ((float)80.0f) /* minimum screen pixels between labeled ticks */
+
+#define RECAPTURE_HIDE_DELAY ((double)0.2) /* give compositor time to unmap window */
+
+#define RECORD_DEFAULT_FPS 60
+#define HISTORY_RESTORE_BUDGET ((double)0.004) /* seconds of band decompression & upload per frame */
 
 #define CANVAS_BACKGROUND_COLOR ((Color){35, 35, 35, 255})
 
 static int screenWidth = 800, screenHeight = 600;
 static int renderWidth, renderHeight;
-static float screenScale;
+static RenderTexture2D splMask = {0}; /* spotlight quad, texcoords span render size */
+/* world units per desktop point, world is drawn at pixel density of primary screen */
+static float worldScale = 1.0f;
 
 static bool showSpotlight = false;
 static bool showKeystrokeTips = true;
+static AnnotationTool annotationTool = ANNOTATION_TOOL_NONE;
+static bool showInspector = false;
+static bool showPixelGrid = true; /* fades in from about 8x zoom */
+static bool showRulers = false;
+static bool recaptureFinishPending = false; /* history & inspector wait until the new capture is shown */
+/* stream capture into textures band by band, build inspector tables on demand */
+static bool lowMemory = false;
+static bool noHistory = false;
 #if defined(DEBUG)
 static bool showDebugInfo = true;
 #elif defined(RELEASE)
 static bool showDebugInfo = false;
 #endif
 
+/* capture backend selected by command line, NULL means fallback chain */
+static const char *backendName = NULL;
+static const ScreenshotBackend *screenshotBackend = NULL;
+static ScreenshotOptions screenshotOpts = {0};
+static ScreenshotContext screenshotContextArray[SCREENSHOT_MAX_COUNT];
+
+/* session recording output, `.y4m' stream or qoi sequence directory */
+static const char *recordPath = NULL;
+
 struct InputContext {
     Vector2 mousePos;
     Vector2 mouseWorldPos;
     Vector2 mouseDelta;
     float wheelDelta;
+    /* region selected for pixel inspector, in world coordinates */
+    bool selecting;
+    Vector2 selectionStart;
+    Rectangle selection;
 } inputCtx = {0};
 
 struct ScreenshotTextureContext {
     struct ScreenshotTex {
         Texture2D tex;
+        Image image; /* CPU side copy in RGBA8, for pixel inspector, low memory mode reads it back only while shown */
         int posx;
         int posy;
         size_t width;
         size_t height;
+        float scale; /* pixels per desktop point */
         bool isPrimary;
     } *screenshots;
     size_t length;
 } screenshotTexCtx = {0};
 
-#define IS_SCREENSHOT_PRIMARY(idx) ((bool)screenshotTexCtx.screenshots[i].isPrimary)
-#define TEX_OF_SCREENSHOT(idx) ((Texture2D)screenshotTexCtx.screenshots[i].tex)
-#define POSX_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[i].posx)
-#define POSY_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[i].posy)
-#define WIDTH_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[i].width)
-#define HEIGHT_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[i].height)
+#define IS_SCREENSHOT_PRIMARY(idx) ((bool)screenshotTexCtx.screenshots[idx].isPrimary)
+#define TEX_OF_SCREENSHOT(idx) ((Texture2D)screenshotTexCtx.screenshots[idx].tex)
+#define POSX_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[idx].posx)
+#define POSY_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[idx].posy)
+#define WIDTH_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[idx].width)
+#define HEIGHT_OF_SCREENSHOT(idx) ((int)screenshotTexCtx.screenshots[idx].height)
+#define SCALE_OF_SCREENSHOT(idx) ((float)screenshotTexCtx.screenshots[idx].scale)
 
 struct CameraContext {
     Camera2D camera;
     float targetZoom;
+    float zoomVelocity;  /* log zoom per second */
+    Vector2 panVelocity; /* screen pixels per second */
+    bool dragging;
+    double accumulator; /* time not simulated yet */
 } cameraCtx = {0};
 
+struct FrameContext {
+    double lastTime;
+    float deltaTime; /* clamped, 0 on the first frame woken from waiting for events */
+    bool waiting;
+} frameCtx = {0};
+
+typedef enum SpotlightShape {
+    SPL_SHAPE_CIRCLE = 0,
+    SPL_SHAPE_ROUNDED_RECTANGLE,
+    SPL_SHAPE_ELLIPSE,
+    SPL_SHAPE_COUNT,
+} SpotlightShape;
+
 struct SpotlightShaderUniformLocationContext {
     int opacity;
-    int center;
-    int radius;
     int textureWidth;
     int textureHeight;
+    int spotlightCount;
+    int spotlightBounds;
+    int spotlightParams;
 } splShaderLocCtx = {0};
 
 struct SpotlightShaderContext {
     bool enable;
     float currentOpacity;
     float targetOpacity;
-    float center[2];
     float currentRadius;
     float targetRadius;
+    SpotlightShape shape;
+    /* highlights pinned in world space, they follow panning & zooming */
+    struct Spotlight {
+        SpotlightShape shape;
+        Vector2 center;
+        Vector2 halfSize;
+    } pinned[SPL_MAX_COUNT - 1];
+    size_t pinnedCount;
+    /* uniform arrays, slot 0 is the spotlight under cursor */
+    int count;
+    float bounds[SPL_MAX_COUNT][4];
+    float params[SPL_MAX_COUNT][4];
     int textureWidth;
     int textureHeight;
 } splShaderCtx = {.targetRadius = 100.0f};
 
 static Shader splShader = {0};
 
+typedef enum LensFilter {
+    LENS_FILTER_NEAREST = 0,
+    LENS_FILTER_BICUBIC,
+    LENS_FILTER_COUNT,
+} LensFilter;
+
+struct LensShaderContext {
+    bool enable;
+    float magnification;
+    float radius; /* screen pixels */
+    LensFilter filter;
+    float center[2];
+    float worldRadius;
+    float pixelSize;
+} lensShaderCtx = {.magnification = 4.0f, .radius = 150.0f, .filter = LENS_FILTER_BICUBIC};
+
+/* screenshots & pixel grid in one pass, lens in a quad on top, one program per CANVAS_SHADER_* combination */
+struct CanvasShaderContext {
+    struct CanvasShaderVariant {
+        Shader shader;
+        bool loaded; /* compiled on first use */
+        int texRect;
+        int lensCenter;
+        int lensRadius;
+        int magnification;
+        int pixelSize;
+        int screenRects;
+        int screenSizes;
+        int screenCount;
+    } variants[CANVAS_SHADER_VARIANT_COUNT];
+    int current; /* variant drawn this frame */
+} canvasShaderCtx = {0};
+
+static int parseArguments(int argc, char **argv);
+static void printUsage(const char *program);
 static int loadScreenshot(ScreenshotContext *ctxArray, size_t count);
-static void getSpotlightShaderUniformLocation(void);
+static int streamScreenshot(void);
+static int restreamScreenshot(void);
+static int beginScreenshotBand(void *user, size_t idx, const ScreenshotContext *ctx);
+static int uploadScreenshotBand(void *user, size_t idx, int y, int height, const unsigned char *rgba);
+static Image decodeScreenshot(ScreenshotContext *ctx);
+static int reloadScreenshot(ScreenshotContext *ctxArray, size_t count);
+static void unloadScreenshot(void);
+static void unloadScreenshotTextures(struct ScreenshotTextureContext *texCtx);
+static void freeScreenshotContext(ScreenshotContext *ctxArray, size_t count);
+static float getScreenshotContextScale(const ScreenshotContext *ctx);
+static Rectangle getScreenshotWorldRect(size_t idx);
+static void setupPrimaryScreen(void);
+static void startScreenshotInspector(void);
+static void stopScreenshotInspector(void);
+static int recaptureScreenshot(void);
+static void finishRecapture(void);
+static void saveScreenshotHistory(void);
+static void stepScreenshotHistory(int direction);
+static void updateScreenshotHistory(void);
+static void loadSpotlightShader(void);
+static bool isSpotlightVisible(void);
 static void updateInputContext(void);
+static void updateFrameContext(void);
 static void updateCameraContext(void);
+static void stepCamera(float dt);
+static bool isCameraSettled(void);
+static void updateEventWaiting(void);
 static void updateSpotlightShaderContext(void);
 static void setSpotlightShaderUniformValues(void);
+static struct CanvasShaderVariant *loadCanvasShaderVariant(int variant);
+static void updateCanvasShaderContext(void);
+static bool isPixelGridVisible(void);
+static void updateLensShaderContext(void);
+static void setCanvasShaderUniformValues(void);
+static void updateScreenshotTextureFilter(void);
+static void drawScreenshots(void);
+static void drawLens(void);
+static void drawRulers(void);
+static bool getScreenshotPixelAt(Vector2 worldPos, size_t *idx, int *px, int *py);
+static void handleInspectorInput(void);
+static void drawPixelInspector(void);
+static Vector2 getSpotlightHalfSize(SpotlightShape shape, float radius);
+static void pinSpotlight(void);
 static void handleInput(void);
 static void drawDebugInfo(void);
 static void drawKeystrokeTips(void);
+static void handleAnnotationInput(void);
+static void toggleRecording(void);
 
-int main(void) {
-    size_t contextCnt;
-    ScreenshotContext *contextArray;
-
-    contextArray = captureScreenshot(&contextCnt);
-    if (!contextArray) {
-        TraceLog(LOG_WARNING, "failed to capture screenshot");
-        return EXIT_FAILURE;
-    }
+int main(int argc, char **argv) {
+    int ret = parseArguments(argc, argv);
+    if (ret >= 0) return ret;
 
-    TraceLog(LOG_WARNING, "screenshot count: %lu", contextCnt);
-    for (size_t i = 0; i < contextCnt; ++i) {
-        TraceLog(LOG_WARNING, "screenshot %lu size: %lu, pos: (%d, %d)", i, contextArray[i].size, contextArray[i].posx, contextArray[i].posy);
+    ScreenshotContext *contextArray = screenshotContextArray;
+    int captured = 0;
+    if (!lowMemory) {
+        captured = captureScreenshot(backendName, &screenshotOpts, contextArray, SCREENSHOT_MAX_COUNT, &screenshotBackend);
+        if (captured <= 0) {
+            TraceLog(LOG_WARNING, "failed to capture screenshot");
+            return EXIT_FAILURE;
+        }
     }
 
 #if defined(DEBUG)
@@ -115,9 +277,27 @@ int main(void) {
 #elif defined(RELEASE)
     SetTraceLogLevel(LOG_WARNING);
 #endif
-    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_MSAA_4X_HINT);
+    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_MSAA_4X_HINT | (lowMemory ? FLAG_WINDOW_HIDDEN : 0));
     InitWindow(800, 600, "magnifier");
 
+    if (lowMemory) {
+        /* textures need a GL context, window stays hidden so it isn't captured */
+        captured = streamScreenshot();
+        if (captured <= 0) {
+            TraceLog(LOG_WARNING, "failed to capture screenshot");
+            CloseWindow();
+            return EXIT_FAILURE;
+        }
+        ClearWindowState(FLAG_WINDOW_HIDDEN);
+    }
+    size_t contextCnt = (size_t)captured;
+
+    TraceLog(LOG_WARNING, "screenshot backend: %s", screenshotBackend->name);
+    TraceLog(LOG_WARNING, "screenshot count: %lu", contextCnt);
+    for (size_t i = 0; i < contextCnt; ++i) {
+        TraceLog(LOG_WARNING, "screenshot %lu size: %lu, pos: (%d, %d)", i, contextArray[i].size, contextArray[i].posx, contextArray[i].posy);
+    }
+
     /* get resolution info */
     int currentMonitor = GetCurrentMonitor();
     screenWidth = GetMonitorWidth(currentMonitor);
@@ -127,49 +307,60 @@ int main(void) {
     ToggleFullscreen();
 
     /* load screenshot into memory */
-    loadScreenshot(contextArray, contextCnt);
-    /* load fragment shader */
-    splShader = LoadShaderFromMemory(NULL, SPOTLIGHT_SHADER_SRC);
-    /* get shader uniform location */
-    getSpotlightShaderUniformLocation();
+    if (!lowMemory) loadScreenshot(contextArray, contextCnt);
+    if (!noHistory && initHistory() == 0) saveScreenshotHistory();
+    logMemStats("after startup");
+    /* fragment shaders are compiled on first use, only the variants the session needs */
 
-    /* calculate camera zoom & set camera target to primary screen */
-    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
-        if (!IS_SCREENSHOT_PRIMARY(i)) continue;
-        renderWidth = WIDTH_OF_SCREENSHOT(i);
-        renderHeight = HEIGHT_OF_SCREENSHOT(i);
-        screenScale = (float)WIDTH_OF_SCREENSHOT(i) / (float)screenWidth;
-        cameraCtx.camera.target = (Vector2){POSX_OF_SCREENSHOT(i), POSY_OF_SCREENSHOT(i)};
-        cameraCtx.camera.zoom = 1 / screenScale;
-        cameraCtx.targetZoom = cameraCtx.camera.zoom;
-    }
+    setupPrimaryScreen();
 
-    RenderTexture2D splMask = LoadRenderTexture(renderWidth, renderHeight);
+    initAnnotationLayer(screenWidth, screenHeight);
+    if (recordPath) toggleRecording();
 
     // clang-format off
     while(!WindowShouldClose()) {
+        updateFrameContext();              /* update animation clock */
         updateInputContext();              /* update input context */
         handleInput();                     /* handle user input */
+        updateScreenshotHistory();         /* upload bands of restored snapshot */
         updateCameraContext();             /* update camera context */
         updateSpotlightShaderContext();    /* update shader context */
         setSpotlightShaderUniformValues(); /* set shader uniform value */
+        updateLensShaderContext();         /* update lens context */
+        updateCanvasShaderContext();       /* pick canvas shader variant */
+        setCanvasShaderUniformValues();    /* set lens & grid uniform value */
+        updateAnnotationLayer(cameraCtx.camera); /* rasterize new strokes */
+        updateEventWaiting();              /* sleep until next event when idle */
 
         /* rendering */
         BeginDrawing();
             ClearBackground(CANVAS_BACKGROUND_COLOR);
 
             BeginMode2D(cameraCtx.camera);
-                for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
-                    DrawTexture(TEX_OF_SCREENSHOT(i), POSX_OF_SCREENSHOT(i) * screenScale, POSY_OF_SCREENSHOT(i) * screenScale, WHITE);
-                }
+                drawScreenshots();
             EndMode2D();
 
-            BeginShaderMode(splShader);
-                DrawTextureRec(splMask.texture, (Rectangle){0, 0, (float)screenWidth, (float)screenHeight}, (Vector2){0, 0}, BLANK);
-            EndShaderMode();
+            drawAnnotationLayer(cameraCtx.camera);
+            if (annotationTool == ANNOTATION_TOOL_ERASER) {
+                DrawCircleLinesV(inputCtx.mousePos, ERASER_RADIUS, RAYWHITE);
+            }
+
+            if (isSpotlightVisible()) {
+                BeginShaderMode(splShader);
+                    DrawTextureRec(splMask.texture, (Rectangle){0, 0, (float)screenWidth, (float)screenHeight}, (Vector2){0, 0}, BLANK);
+                EndShaderMode();
+            }
+
+            if (showRulers) {
+                drawRulers();
+            }
 
             DrawFPS(10, 10);
 
+            if (showInspector) {
+                drawPixelInspector();
+            }
+
             if (showDebugInfo) {
                 drawDebugInfo();
             }
@@ -177,21 +368,112 @@ int main(void) {
             if (showKeystrokeTips) {
                 drawKeystrokeTips();
             }
+
+            captureRecordingFrame();       /* everything above ends up in the recording */
+            if (isRecording()) {
+                DrawCircle(screenWidth - 20, 20, 6, RED);
+            }
         EndDrawing();
+
+        finishRecapture();                 /* snapshot copy after recaptured frame is shown */
     }
     // clang-format on
 
     /* unload everything */
-    UnloadShader(splShader);
-    UnloadRenderTexture(splMask);
-    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
-        UnloadTexture(screenshotTexCtx.screenshots[i].tex);
+    stopRecording();
+    unloadHistory();
+    if (splShader.id) UnloadShader(splShader);
+    for (int i = 0; i < CANVAS_SHADER_VARIANT_COUNT; ++i) {
+        if (canvasShaderCtx.variants[i].loaded) UnloadShader(canvasShaderCtx.variants[i].shader);
     }
-    free(screenshotTexCtx.screenshots);
+    UnloadRenderTexture(splMask);
+    unloadAnnotationLayer();
+    unloadScreenshot();
     CloseWindow();
+    logMemStats("at exit");
     return EXIT_SUCCESS;
 }
 
+/* returns exit code when program should exit right away, -1 otherwise */
+int parseArguments(int argc, char **argv) {
+    static const struct option longOptions[] = {
+        {"backend", required_argument, NULL, 'b'},
+        {"input", required_argument, NULL, 'i'},
+        {"layout", required_argument, NULL, 'l'},
+        {"list-backends", no_argument, NULL, 'L'},
+        {"record", required_argument, NULL, 'R'},
+        {"low-memory", no_argument, NULL, 'M'},
+        {"no-history", no_argument, NULL, 'N'},
+        {"help", no_argument, NULL, 'h'},
+        {0},
+    };
+    size_t backendCnt;
+    const ScreenshotBackend *const *backends;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "b:i:l:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'b':
+            backendName = optarg;
+            if (findScreenshotBackend(backendName) == NULL) {
+                fprintf(stderr, "unknown backend: %s, see --list-backends\n", backendName);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'i':
+            screenshotOpts.input = optarg;
+            break;
+        case 'l':
+            screenshotOpts.layout = optarg;
+            break;
+        case 'L':
+            backends = getScreenshotBackends(&backendCnt);
+            for (size_t i = 0; i < backendCnt; ++i) {
+                printf("%-10s %s%s\n", backends[i]->name, backends[i]->description, backends[i]->fallback ? "" : " (explicit only)");
+            }
+            return EXIT_SUCCESS;
+        case 'R':
+            recordPath = optarg;
+            break;
+        case 'M':
+            lowMemory = true;
+            break;
+        case 'N':
+            noHistory = true;
+            break;
+        case 'h':
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        default:
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* history keeps a CPU copy of every screen, which low memory mode drops */
+    if (lowMemory) noHistory = true;
+
+    /* --input alone implies file backend */
+    if (backendName == NULL && screenshotOpts.input) backendName = "file";
+    return -1;
+}
+
+void printUsage(const char *program) {
+    printf("usage: %s [options]\n"
+           "  -b, --backend NAME     capture backend, see --list-backends\n"
+           "  -i, --input PATHS      comma separated images for file backend\n"
+           "  -l, --layout LAYOUT    raw layout for file backend, WIDTHxHEIGHT[:rgba|bgra|rgbx|bgrx|rgb|bgr]\n"
+           "                         or geometry for synthetic backend, WIDTHxHEIGHT[@SCALE][,...]\n"
+           "      --list-backends    list capture backends\n"
+           "      --record PATH      record session right away, PATH.y4m for a video stream,\n"
+           "                         otherwise a directory of qoi frames\n"
+           "      --low-memory       stream capture into textures band by band, keep no CPU copy,\n"
+           "                         skip history, pixel inspector reads textures back while shown\n"
+           "      --no-history       don't keep captures on disk\n"
+           "  -h, --help             show this help\n",
+           program);
+}
+
 int loadScreenshot(ScreenshotContext *ctxArr, size_t count) {
     screenshotTexCtx.screenshots = malloc(sizeof(*screenshotTexCtx.screenshots) * count);
     if (screenshotTexCtx.screenshots == NULL) {
@@ -201,30 +483,471 @@ int loadScreenshot(ScreenshotContext *ctxArr, size_t count) {
 
     /* load screenshot into memory */
     for (size_t i = 0; i < count; ++i) {
-        Image image = LoadImageFromMemory(".png", ctxArr[i].data, (int)ctxArr[i].size);
+        Image image = decodeScreenshot(&ctxArr[i]);
         screenshotTexCtx.screenshots[i].tex = LoadTextureFromImage(image);
+        addMemStat(MEM_STAGE_TEXTURE, (size_t)image.width * image.height * 4);
+        if (lowMemory) {
+            /* backend couldn't stream, still don't keep a second copy around */
+            subMemStat(MEM_STAGE_IMAGE, (size_t)image.width * image.height * 4);
+            UnloadImage(image);
+            image = (Image){0};
+        }
+        screenshotTexCtx.screenshots[i].image = image;
         screenshotTexCtx.screenshots[i].posx = ctxArr[i].posx;
         screenshotTexCtx.screenshots[i].posy = ctxArr[i].posy;
         screenshotTexCtx.screenshots[i].width = ctxArr[i].width;
         screenshotTexCtx.screenshots[i].height = ctxArr[i].height;
+        screenshotTexCtx.screenshots[i].scale = getScreenshotContextScale(&ctxArr[i]);
         screenshotTexCtx.screenshots[i].isPrimary = ctxArr[i].isPrimary;
-        UnloadImage(image);
     }
 
-    /* free memory */
+    freeScreenshotContext(ctxArr, count);
+    startScreenshotInspector();
+    return 0;
+}
+
+int streamScreenshot(void) {
+    /* bands go into new textures, the shown capture stays until this one succeeded */
+    struct ScreenshotTextureContext staging = {0};
+    ScreenshotBandSink sink = {beginScreenshotBand, uploadScreenshotBand, &staging};
+    /* recapture sticks to the backend that worked at startup */
+    const char *name = screenshotBackend ? screenshotBackend->name : backendName;
+    int captured = captureScreenshotBands(name, &screenshotOpts, screenshotContextArray, SCREENSHOT_MAX_COUNT, &sink, &screenshotBackend);
+    if (captured <= 0) {
+        unloadScreenshotTextures(&staging);
+        return -1;
+    }
+
+    if (screenshotContextArray[0].data) {
+        /* backend can't stream, whole frames were captured */
+        unloadScreenshotTextures(&staging);
+        unloadScreenshot();
+        return loadScreenshot(screenshotContextArray, (size_t)captured) ? -1 : captured;
+    }
+
+    unloadScreenshot();
+    screenshotTexCtx = staging;
+    screenshotTexCtx.length = (size_t)captured;
+    startScreenshotInspector();
+    return captured;
+}
+
+/* low memory recapture, bands go straight into fresh textures like at startup */
+int restreamScreenshot(void) {
+    size_t oldCount = screenshotTexCtx.length;
+    size_t oldSize[SCREENSHOT_MAX_COUNT][2];
+    for (size_t i = 0; i < oldCount; ++i) {
+        oldSize[i][0] = screenshotTexCtx.screenshots[i].width;
+        oldSize[i][1] = screenshotTexCtx.screenshots[i].height;
+    }
+
+    int captured = streamScreenshot();
+    if (captured <= 0) return captured;
+
+    bool sameGeometry = (size_t)captured == oldCount;
+    for (size_t i = 0; sameGeometry && i < oldCount; ++i) {
+        sameGeometry = oldSize[i][0] == screenshotTexCtx.screenshots[i].width &&
+                       oldSize[i][1] == screenshotTexCtx.screenshots[i].height;
+    }
+    if (!sameGeometry) setupPrimaryScreen();
+    return captured;
+}
+
+/* allocate empty texture of one screen, its pixels arrive band by band */
+int beginScreenshotBand(void *user, size_t idx, const ScreenshotContext *ctx) {
+    struct ScreenshotTextureContext *texCtx = user;
+    /* a backend earlier in fallback chain may have failed half way */
+    if (idx == 0) unloadScreenshotTextures(texCtx);
+    if (texCtx->screenshots == NULL) {
+        texCtx->screenshots = calloc(SCREENSHOT_MAX_COUNT, sizeof(*texCtx->screenshots));
+        if (texCtx->screenshots == NULL) return -1;
+    }
+
+    struct ScreenshotTex *shot = &texCtx->screenshots[idx];
+    size_t size = ctx->width * ctx->height * 4;
+    shot->image = (Image){0};
+    shot->tex = (Texture2D){
+        .id = rlLoadTexture(NULL, (int)ctx->width, (int)ctx->height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1),
+        .width = (int)ctx->width,
+        .height = (int)ctx->height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    addMemStat(MEM_STAGE_TEXTURE, size);
+
+    shot->posx = ctx->posx;
+    shot->posy = ctx->posy;
+    shot->width = ctx->width;
+    shot->height = ctx->height;
+    shot->scale = getScreenshotContextScale(ctx);
+    shot->isPrimary = ctx->isPrimary;
+    texCtx->length = idx + 1;
+    return 0;
+}
+
+int uploadScreenshotBand(void *user, size_t idx, int y, int height, const unsigned char *rgba) {
+    struct ScreenshotTextureContext *texCtx = user;
+    struct ScreenshotTex *shot = &texCtx->screenshots[idx];
+    UpdateTextureRec(shot->tex, (Rectangle){0, (float)y, (float)shot->width, (float)height}, rgba);
+    return 0;
+}
+
+int reloadScreenshot(ScreenshotContext *ctxArr, size_t count) {
+    bool sameGeometry = count == screenshotTexCtx.length;
+    for (size_t i = 0; sameGeometry && i < count; ++i) {
+        sameGeometry = ctxArr[i].width == screenshotTexCtx.screenshots[i].width &&
+                       ctxArr[i].height == screenshotTexCtx.screenshots[i].height;
+    }
+
+    if (!sameGeometry) {
+        TraceLog(LOG_INFO, "screen geometry changed, reallocating textures");
+        unloadScreenshot();
+        int ret = loadScreenshot(ctxArr, count);
+        setupPrimaryScreen();
+        return ret;
+    }
+
+    /* inspector reads old pixels on its worker thread */
+    releaseInspectorTables();
+
+    /* same geometry, upload new pixels into existing textures */
     for (size_t i = 0; i < count; ++i) {
-        free(ctxArr[i].data);
+        Image image = decodeScreenshot(&ctxArr[i]);
+        UpdateTexture(screenshotTexCtx.screenshots[i].tex, image.data);
+        subMemStat(MEM_STAGE_IMAGE, (size_t)image.width * image.height * 4);
+        UnloadImage(screenshotTexCtx.screenshots[i].image);
+        screenshotTexCtx.screenshots[i].image = image;
+        screenshotTexCtx.screenshots[i].posx = ctxArr[i].posx;
+        screenshotTexCtx.screenshots[i].posy = ctxArr[i].posy;
+        screenshotTexCtx.screenshots[i].scale = getScreenshotContextScale(&ctxArr[i]);
+        screenshotTexCtx.screenshots[i].isPrimary = ctxArr[i].isPrimary;
     }
-    free((ScreenshotContext *)ctxArr);
+
+    /* inspector tables are restarted by finishRecapture, after the new pixels are shown */
+    freeScreenshotContext(ctxArr, count);
     return 0;
 }
 
-void getSpotlightShaderUniformLocation(void) {
+Image decodeScreenshot(ScreenshotContext *ctx) {
+    if (ctx->format == SCREENSHOT_FORMAT_RGBA) {
+        /* take over raw pixels, backend won't free them on release */
+        Image image = {
+            .data = ctx->data,
+            .width = (int)ctx->width,
+            .height = (int)ctx->height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+        ctx->data = NULL;
+        subMemStat(MEM_STAGE_CONTEXT, ctx->size);
+        addMemStat(MEM_STAGE_IMAGE, ctx->size);
+        return image;
+    }
+
+    Image image = LoadImageFromMemory(".png", ctx->data, (int)ctx->size);
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    addMemStat(MEM_STAGE_IMAGE, (size_t)image.width * image.height * 4);
+    return image;
+}
+
+void unloadScreenshot(void) {
+    releaseInspectorTables();
+    unloadScreenshotTextures(&screenshotTexCtx);
+}
+
+void unloadScreenshotTextures(struct ScreenshotTextureContext *texCtx) {
+    for (size_t i = 0; i < texCtx->length; ++i) {
+        size_t size = texCtx->screenshots[i].width * texCtx->screenshots[i].height * 4;
+        UnloadTexture(texCtx->screenshots[i].tex);
+        subMemStat(MEM_STAGE_TEXTURE, size);
+        if (texCtx->screenshots[i].image.data) {
+            UnloadImage(texCtx->screenshots[i].image);
+            subMemStat(MEM_STAGE_IMAGE, size);
+        }
+    }
+    free(texCtx->screenshots);
+    texCtx->screenshots = NULL;
+    texCtx->length = 0;
+}
+
+void freeScreenshotContext(ScreenshotContext *ctxArr, size_t count) {
+    screenshotBackend->release(ctxArr, count);
+}
+
+void startScreenshotInspector(void) {
+    /* tables take 12 bytes per pixel, in low memory mode they only exist while shown */
+    if (lowMemory && !showInspector) return;
+    /* a failed capture leaves no screens, zero length arrays are undefined */
+    if (screenshotTexCtx.length == 0) return;
+
+    /* region statistics are built off the render thread */
+    Image images[screenshotTexCtx.length];
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        struct ScreenshotTex *shot = &screenshotTexCtx.screenshots[i];
+        if (shot->image.data == NULL) {
+            /* low memory mode keeps pixels on the GPU only, read them back once */
+            shot->image = LoadImageFromTexture(shot->tex);
+            if (shot->image.data == NULL) return;
+            addMemStat(MEM_STAGE_IMAGE, shot->width * shot->height * 4);
+        }
+        images[i] = shot->image;
+    }
+    startInspectorTables(images, screenshotTexCtx.length);
+}
+
+/* low memory mode drops tables & the pixels they were built from once hidden */
+void stopScreenshotInspector(void) {
+    releaseInspectorTables();
+    if (!lowMemory) return;
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        struct ScreenshotTex *shot = &screenshotTexCtx.screenshots[i];
+        if (shot->image.data == NULL) continue;
+        UnloadImage(shot->image);
+        shot->image = (Image){0};
+        subMemStat(MEM_STAGE_IMAGE, shot->width * shot->height * 4);
+    }
+}
+
+int recaptureScreenshot(void) {
+    int contextCnt;
+
+    /* polling below must not block waiting for events */
+    if (frameCtx.waiting) {
+        DisableEventWaiting();
+        frameCtx.waiting = false;
+    }
+
+    /* hide window, so it doesn't end up in screenshot */
+    SetWindowState(FLAG_WINDOW_HIDDEN);
+    for (double start = GetTime(); GetTime() - start < RECAPTURE_HIDE_DELAY;) {
+        PollInputEvents();
+        WaitTime(0.01);
+    }
+
+    if (lowMemory) {
+        contextCnt = restreamScreenshot();
+    } else {
+        /* stick to the backend that worked at startup */
+        contextCnt = captureScreenshot(screenshotBackend->name, &screenshotOpts, screenshotContextArray, SCREENSHOT_MAX_COUNT, &screenshotBackend);
+        if (contextCnt > 0) {
+            cancelHistoryRestore();
+            reloadScreenshot(screenshotContextArray, (size_t)contextCnt);
+            recaptureFinishPending = true;
+        }
+    }
+
+    if (contextCnt > 0) {
+        updateScreenshotTextureFilter();
+    } else {
+        TraceLog(LOG_WARNING, "failed to recapture screenshot");
+    }
+
+    ClearWindowState(FLAG_WINDOW_HIDDEN);
+    return contextCnt > 0 ? 0 : -1;
+}
+
+/* capture & upload only on the recapture frame, copies for history and inspector come after */
+void finishRecapture(void) {
+    if (!recaptureFinishPending) return;
+    recaptureFinishPending = false;
+    /* geometry changes load from scratch & have started tables already */
+    if (getInspectorState() == INSPECTOR_IDLE) startScreenshotInspector();
+    saveScreenshotHistory();
+}
+
+void saveScreenshotHistory(void) {
+    /* saving copies every screen, which low memory mode can't afford */
+    if (noHistory || screenshotTexCtx.length == 0) return;
+
+    size_t count = screenshotTexCtx.length;
+    Image images[count];
+    ScreenshotContext geometry[count];
+
+    for (size_t i = 0; i < count; ++i) {
+        images[i] = screenshotTexCtx.screenshots[i].image;
+        geometry[i] = (ScreenshotContext){
+            .format = SCREENSHOT_FORMAT_RGBA,
+            .posx = POSX_OF_SCREENSHOT(i),
+            .posy = POSY_OF_SCREENSHOT(i),
+            .width = screenshotTexCtx.screenshots[i].width,
+            .height = screenshotTexCtx.screenshots[i].height,
+            .scale = SCALE_OF_SCREENSHOT(i),
+            .isPrimary = IS_SCREENSHOT_PRIMARY(i),
+        };
+    }
+    saveHistorySnapshot(images, geometry, count);
+}
+
+/* direction > 0 steps to older snapshots, pixels arrive over the next frames */
+void stepScreenshotHistory(int direction) {
+    if (noHistory) return;
+    int position = getHistoryPosition() + direction;
+    if (position < 0 || position >= (int)getHistoryCount()) return;
+
+    ScreenshotContext geometry[SCREENSHOT_MAX_COUNT];
+    int count = beginHistoryRestore(position, geometry, SCREENSHOT_MAX_COUNT);
+    if (count <= 0) return;
+
+    bool sameGeometry = (size_t)count == screenshotTexCtx.length;
+    for (int i = 0; sameGeometry && i < count; ++i) {
+        sameGeometry = geometry[i].width == screenshotTexCtx.screenshots[i].width &&
+                       geometry[i].height == screenshotTexCtx.screenshots[i].height;
+    }
+
+    if (sameGeometry) {
+        /* inspector reads pixels that are about to be overwritten */
+        releaseInspectorTables();
+        for (int i = 0; i < count; ++i) {
+            screenshotTexCtx.screenshots[i].posx = geometry[i].posx;
+            screenshotTexCtx.screenshots[i].posy = geometry[i].posy;
+            screenshotTexCtx.screenshots[i].scale = getScreenshotContextScale(&geometry[i]);
+            screenshotTexCtx.screenshots[i].isPrimary = geometry[i].isPrimary;
+        }
+        return;
+    }
+
+    /* allocate blank images & textures of restored geometry, bands fill them in */
+    unloadScreenshot();
+    screenshotTexCtx.screenshots = calloc((size_t)count, sizeof(*screenshotTexCtx.screenshots));
+    if (screenshotTexCtx.screenshots == NULL) {
+        cancelHistoryRestore();
+        return;
+    }
+    screenshotTexCtx.length = (size_t)count;
+    for (int i = 0; i < count; ++i) {
+        Image image = GenImageColor((int)geometry[i].width, (int)geometry[i].height, BLANK);
+        screenshotTexCtx.screenshots[i].tex = LoadTextureFromImage(image);
+        addMemStat(MEM_STAGE_IMAGE, geometry[i].size);
+        addMemStat(MEM_STAGE_TEXTURE, geometry[i].size);
+        screenshotTexCtx.screenshots[i].image = image;
+        screenshotTexCtx.screenshots[i].posx = geometry[i].posx;
+        screenshotTexCtx.screenshots[i].posy = geometry[i].posy;
+        screenshotTexCtx.screenshots[i].width = geometry[i].width;
+        screenshotTexCtx.screenshots[i].height = geometry[i].height;
+        screenshotTexCtx.screenshots[i].scale = getScreenshotContextScale(&geometry[i]);
+        screenshotTexCtx.screenshots[i].isPrimary = geometry[i].isPrimary;
+    }
+    setupPrimaryScreen();
+    updateScreenshotTextureFilter();
+}
+
+void updateScreenshotHistory(void) {
+    if (!isHistoryRestoring()) return;
+    if (screenshotTexCtx.length == 0) {
+        cancelHistoryRestore();
+        return;
+    }
+
+    size_t count = screenshotTexCtx.length;
+    Image images[count];
+    for (size_t i = 0; i < count; ++i) {
+        images[i] = screenshotTexCtx.screenshots[i].image;
+    }
+
+    /* at least one band per frame, so restore always makes progress */
+    HistoryBand band;
+    double start = GetTime();
+    do {
+        if (!nextHistoryBand(images, count, &band)) {
+            startScreenshotInspector();
+            return;
+        }
+        const unsigned char *rows = (const unsigned char *)images[band.screen].data + (size_t)band.y * images[band.screen].width * 4;
+        UpdateTextureRec(TEX_OF_SCREENSHOT(band.screen), (Rectangle){0, (float)band.y, (float)images[band.screen].width, (float)band.height}, rows);
+    } while (GetTime() - start < HISTORY_RESTORE_BUDGET);
+}
+
+void loadSpotlightShader(void) {
+    if (splShader.id) return;
+    splShader = LoadShaderFromMemory(NULL, SPOTLIGHT_SHADER_SRC);
+    TraceLog(LOG_INFO, "spotlight shader %08x compiled", SPOTLIGHT_SHADER_HASH);
     splShaderLocCtx.opacity = GetShaderLocation(splShader, "opacity");
-    splShaderLocCtx.center = GetShaderLocation(splShader, "center");
-    splShaderLocCtx.radius = GetShaderLocation(splShader, "radius");
     splShaderLocCtx.textureWidth = GetShaderLocation(splShader, "textureWidth");
     splShaderLocCtx.textureHeight = GetShaderLocation(splShader, "textureHeight");
+    splShaderLocCtx.spotlightCount = GetShaderLocation(splShader, "spotlightCount");
+    splShaderLocCtx.spotlightBounds = GetShaderLocation(splShader, "spotlightBounds");
+    splShaderLocCtx.spotlightParams = GetShaderLocation(splShader, "spotlightParams");
+}
+
+float getScreenshotContextScale(const ScreenshotContext *ctx) {
+    return ctx->scale > 0.0f ? ctx->scale : 1.0f;
+}
+
+/* screens keep their own pixel density, so a texel covers scale of primary / own scale world units */
+/* render size, scales & camera follow the primary screen, world units are its pixels */
+void setupPrimaryScreen(void) {
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        if (!IS_SCREENSHOT_PRIMARY(i)) continue;
+        renderWidth = WIDTH_OF_SCREENSHOT(i);
+        renderHeight = HEIGHT_OF_SCREENSHOT(i);
+        worldScale = SCALE_OF_SCREENSHOT(i);
+        /* camera target at primary screen, one desktop point per window point, whatever width the capture has */
+        Rectangle rect = getScreenshotWorldRect(i);
+        cameraCtx.camera.target = (Vector2){rect.x, rect.y};
+        cameraCtx.camera.zoom = 1 / worldScale;
+        cameraCtx.targetZoom = cameraCtx.camera.zoom;
+        cameraCtx.zoomVelocity = 0.0f;
+        cameraCtx.panVelocity = (Vector2){0, 0};
+    }
+
+    if (splMask.texture.width == renderWidth && splMask.texture.height == renderHeight) return;
+    if (splMask.id) UnloadRenderTexture(splMask);
+    splMask = LoadRenderTexture(renderWidth, renderHeight);
+}
+
+Rectangle getScreenshotWorldRect(size_t idx) {
+    float size = worldScale / SCALE_OF_SCREENSHOT(idx);
+    return (Rectangle){
+        (int)(POSX_OF_SCREENSHOT(idx) * worldScale),
+        (int)(POSY_OF_SCREENSHOT(idx) * worldScale),
+        WIDTH_OF_SCREENSHOT(idx) * size,
+        HEIGHT_OF_SCREENSHOT(idx) * size,
+    };
+}
+
+bool getScreenshotPixelAt(Vector2 worldPos, size_t *idx, int *px, int *py) {
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        Rectangle rect = getScreenshotWorldRect(i);
+        float density = SCALE_OF_SCREENSHOT(i) / worldScale; /* pixels per world unit */
+        int x = (int)floorf((worldPos.x - rect.x) * density);
+        int y = (int)floorf((worldPos.y - rect.y) * density);
+        if (x < 0 || y < 0 || x >= WIDTH_OF_SCREENSHOT(i) || y >= HEIGHT_OF_SCREENSHOT(i)) continue;
+        *idx = i;
+        *px = x;
+        *py = y;
+        return true;
+    }
+    return false;
+}
+
+struct CanvasShaderVariant *loadCanvasShaderVariant(int variant) {
+    static const char *sources[CANVAS_SHADER_VARIANT_COUNT] = CANVAS_SHADER_SRCS;
+    static const unsigned int hashes[CANVAS_SHADER_VARIANT_COUNT] = CANVAS_SHADER_HASHES;
+    if (sources[variant] == NULL) {
+        /* flag without its dependency, e.g. bicubic without lens, isn't generated */
+        TraceLog(LOG_WARNING, "canvas shader variant %d doesn't exist, using base", variant);
+        variant = 0;
+    }
+    struct CanvasShaderVariant *v = &canvasShaderCtx.variants[variant];
+    if (v->loaded) return v;
+
+    /* uniforms compiled out of a variant get location -1, setting them is a no-op */
+    v->shader = LoadShaderFromMemory(NULL, sources[variant]);
+    v->texRect = GetShaderLocation(v->shader, "texRect");
+    v->lensCenter = GetShaderLocation(v->shader, "lensCenter");
+    v->lensRadius = GetShaderLocation(v->shader, "lensRadius");
+    v->magnification = GetShaderLocation(v->shader, "magnification");
+    v->pixelSize = GetShaderLocation(v->shader, "pixelSize");
+    v->screenRects = GetShaderLocation(v->shader, "screenRects");
+    v->screenSizes = GetShaderLocation(v->shader, "screenSizes");
+    v->screenCount = GetShaderLocation(v->shader, "screenCount");
+    /* lens samplers live on texture units right after texture0 */
+    int units[LENS_MAX_SCREENS];
+    for (int i = 0; i < LENS_MAX_SCREENS; ++i) units[i] = i + 1;
+    SetShaderValueV(v->shader, GetShaderLocation(v->shader, "screens"), units, SHADER_UNIFORM_INT, LENS_MAX_SCREENS);
+    v->loaded = true;
+    TraceLog(LOG_INFO, "canvas shader variant %d (%08x) compiled", variant, hashes[variant]);
+    return v;
 }
 
 void updateInputContext(void) {
@@ -234,18 +957,80 @@ void updateInputContext(void) {
     inputCtx.wheelDelta = GetMouseWheelMove();
 }
 
+void updateFrameContext(void) {
+    double now = GetTime();
+    /* time spent waiting for events is idle, only the frame that woke up skips it */
+    frameCtx.deltaTime = frameCtx.waiting ? 0.0f : fminf((float)(now - frameCtx.lastTime), MAX_FRAME_TIME);
+    frameCtx.lastTime = now;
+}
+
+/*
+ * Fixed steps keep the motion identical at any render rate and when frames
+ * are dropped, the remainder carries over to next frame.
+ */
 void updateCameraContext(void) {
-    float deltaTime = GetFrameTime();
+    cameraCtx.accumulator += frameCtx.deltaTime;
+    while (cameraCtx.accumulator >= CAMERA_STEP) {
+        stepCamera((float)CAMERA_STEP);
+        cameraCtx.accumulator -= CAMERA_STEP;
+    }
+}
 
-    if (cameraCtx.camera.zoom < cameraCtx.targetZoom) {
-        cameraCtx.camera.zoom = Clamp(cameraCtx.camera.zoom + deltaTime * 5.0f, ZOOM_MIN, cameraCtx.targetZoom);
+void stepCamera(float dt) {
+    /* critically damped spring on log zoom, equal zoom ratios take equal time */
+    float offset = logf(cameraCtx.camera.zoom) - logf(cameraCtx.targetZoom);
+    float accel = -CAMERA_ZOOM_OMEGA * CAMERA_ZOOM_OMEGA * offset - 2.0f * CAMERA_ZOOM_OMEGA * cameraCtx.zoomVelocity;
+    cameraCtx.zoomVelocity += accel * dt;
+    offset += cameraCtx.zoomVelocity * dt;
+    bool zoomSettled = fabsf(offset) < CAMERA_ZOOM_EPSILON && fabsf(cameraCtx.zoomVelocity) < CAMERA_ZOOM_EPSILON;
+    if (zoomSettled) {
+        cameraCtx.camera.zoom = cameraCtx.targetZoom;
+        cameraCtx.zoomVelocity = 0.0f;
     } else {
-        cameraCtx.camera.zoom = Clamp(cameraCtx.camera.zoom - deltaTime * 5.0f, cameraCtx.targetZoom, ZOOM_MAX);
+        cameraCtx.camera.zoom = cameraCtx.targetZoom * expf(offset);
+    }
+
+    /* pan inertia after release, velocity is kept in screen space so it feels the same at any zoom */
+    bool panSettled = Vector2Length(cameraCtx.panVelocity) < CAMERA_PAN_STOP_SPEED;
+    if (!cameraCtx.dragging) {
+        if (panSettled) {
+            cameraCtx.panVelocity = Vector2Zero();
+        } else {
+            Vector2 delta = Vector2Scale(cameraCtx.panVelocity, -dt / cameraCtx.camera.zoom);
+            cameraCtx.camera.target = Vector2Add(cameraCtx.camera.target, delta);
+            cameraCtx.panVelocity = Vector2Scale(cameraCtx.panVelocity, expf(-CAMERA_PAN_FRICTION * dt));
+        }
     }
 }
 
+/* from live state, input may have moved a target while waiting for events */
+bool isCameraSettled(void) {
+    return fabsf(logf(cameraCtx.camera.zoom / cameraCtx.targetZoom)) <= CAMERA_ZOOM_EPSILON &&
+           fabsf(cameraCtx.zoomVelocity) < CAMERA_ZOOM_EPSILON &&
+           Vector2Length(cameraCtx.panVelocity) < CAMERA_PAN_STOP_SPEED &&
+           !cameraCtx.dragging;
+}
+
+/* render only on input once nothing animates or streams anymore */
+void updateEventWaiting(void) {
+    bool idle = isCameraSettled() &&
+                splShaderCtx.currentOpacity == splShaderCtx.targetOpacity &&
+                splShaderCtx.currentRadius == splShaderCtx.targetRadius &&
+                !(showInspector && getInspectorState() == INSPECTOR_BUILDING) &&
+                !recaptureFinishPending &&
+                !isHistoryRestoring() &&
+                !isRecording();
+
+    if (idle && !frameCtx.waiting) {
+        EnableEventWaiting();
+    } else if (!idle && frameCtx.waiting) {
+        DisableEventWaiting();
+    }
+    frameCtx.waiting = idle;
+}
+
 void updateSpotlightShaderContext(void) {
-    float deltaTime = GetFrameTime();
+    float deltaTime = frameCtx.deltaTime;
 
     if (splShaderCtx.currentOpacity < splShaderCtx.targetOpacity) {
         splShaderCtx.currentOpacity = Clamp(splShaderCtx.currentOpacity + deltaTime * 5.0f, SPL_OPACITY_MIN, splShaderCtx.targetOpacity);
@@ -259,25 +1044,259 @@ void updateSpotlightShaderContext(void) {
         splShaderCtx.currentRadius = Clamp(splShaderCtx.currentRadius - deltaTime * 500.0f, splShaderCtx.targetRadius, SPL_RADIUS_MAX);
     }
 
-    splShaderCtx.center[0] = inputCtx.mousePos.x;
-    splShaderCtx.center[1] = inputCtx.mousePos.y;
+    /* slot 0 follows cursor in screen space */
+    Vector2 halfSize = getSpotlightHalfSize(splShaderCtx.shape, splShaderCtx.currentRadius);
+    splShaderCtx.count = 0;
+    splShaderCtx.bounds[0][0] = inputCtx.mousePos.x;
+    splShaderCtx.bounds[0][1] = inputCtx.mousePos.y;
+    splShaderCtx.bounds[0][2] = halfSize.x;
+    splShaderCtx.bounds[0][3] = halfSize.y;
+    splShaderCtx.params[0][0] = (float)splShaderCtx.shape;
+    splShaderCtx.params[0][1] = splShaderCtx.currentRadius * 0.25f;
+    splShaderCtx.params[0][2] = SPL_FEATHER;
+    ++splShaderCtx.count;
+
+    /* pinned spotlights are projected from world space */
+    for (size_t i = 0; i < splShaderCtx.pinnedCount; ++i) {
+        struct Spotlight *spl = &splShaderCtx.pinned[i];
+        Vector2 center = GetWorldToScreen2D(spl->center, cameraCtx.camera);
+        Vector2 size = Vector2Scale(spl->halfSize, cameraCtx.camera.zoom);
+        float *bounds = splShaderCtx.bounds[splShaderCtx.count];
+        float *params = splShaderCtx.params[splShaderCtx.count];
+
+        bounds[0] = center.x;
+        bounds[1] = center.y;
+        bounds[2] = size.x;
+        bounds[3] = size.y;
+        params[0] = (float)spl->shape;
+        params[1] = fminf(size.x, size.y) * 0.25f;
+        params[2] = SPL_FEATHER;
+        ++splShaderCtx.count;
+    }
+
     splShaderCtx.textureWidth = renderWidth;
     splShaderCtx.textureHeight = renderHeight;
 }
 
+bool isSpotlightVisible(void) {
+    return showSpotlight || splShaderCtx.currentOpacity > SPL_OPACITY_MIN;
+}
+
 void setSpotlightShaderUniformValues(void) {
+    if (!isSpotlightVisible()) return;
+    loadSpotlightShader();
     SetShaderValue(splShader, splShaderLocCtx.opacity, &splShaderCtx.currentOpacity, SHADER_UNIFORM_FLOAT);
-    SetShaderValue(splShader, splShaderLocCtx.center, splShaderCtx.center, SHADER_UNIFORM_VEC2);
-    SetShaderValue(splShader, splShaderLocCtx.radius, &splShaderCtx.currentRadius, SHADER_UNIFORM_FLOAT);
     SetShaderValue(splShader, splShaderLocCtx.textureWidth, &splShaderCtx.textureWidth, SHADER_UNIFORM_INT);
     SetShaderValue(splShader, splShaderLocCtx.textureHeight, &splShaderCtx.textureHeight, SHADER_UNIFORM_INT);
+    SetShaderValue(splShader, splShaderLocCtx.spotlightCount, &splShaderCtx.count, SHADER_UNIFORM_INT);
+    SetShaderValueV(splShader, splShaderLocCtx.spotlightBounds, splShaderCtx.bounds, SHADER_UNIFORM_VEC4, splShaderCtx.count);
+    SetShaderValueV(splShader, splShaderLocCtx.spotlightParams, splShaderCtx.params, SHADER_UNIFORM_VEC4, splShaderCtx.count);
+}
+
+Vector2 getSpotlightHalfSize(SpotlightShape shape, float radius) {
+    if (shape == SPL_SHAPE_CIRCLE) return (Vector2){radius, radius};
+    return (Vector2){radius * SPL_ASPECT, radius};
+}
+
+void pinSpotlight(void) {
+    if (splShaderCtx.pinnedCount >= SPL_MAX_COUNT - 1) {
+        TraceLog(LOG_WARNING, "spotlight limit (%d) reached", SPL_MAX_COUNT);
+        return;
+    }
+    Vector2 halfSize = getSpotlightHalfSize(splShaderCtx.shape, splShaderCtx.targetRadius);
+    splShaderCtx.pinned[splShaderCtx.pinnedCount++] = (struct Spotlight){
+        .shape = splShaderCtx.shape,
+        .center = inputCtx.mouseWorldPos,
+        .halfSize = Vector2Scale(halfSize, 1.0f / cameraCtx.camera.zoom),
+    };
+}
+
+void updateLensShaderContext(void) {
+    lensShaderCtx.center[0] = inputCtx.mouseWorldPos.x;
+    lensShaderCtx.center[1] = inputCtx.mouseWorldPos.y;
+    lensShaderCtx.pixelSize = 1.0f / cameraCtx.camera.zoom;
+    lensShaderCtx.worldRadius = lensShaderCtx.radius * lensShaderCtx.pixelSize;
+}
+
+/* largest texel on screen, in framebuffer pixels, decides whether the grid has faded in anywhere */
+bool isPixelGridVisible(void) {
+    float density = FLT_MAX; /* texels per world unit of the coarsest screen */
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        density = fminf(density, SCALE_OF_SCREENSHOT(i) / worldScale);
+    }
+    if (density == FLT_MAX) return false;
+    /* camera maps world units to window points, same framebuffer pixels per texel as gridLine in canvas.glsl */
+    float pixelsPerPoint = (float)GetRenderWidth() / (float)GetScreenWidth();
+    float texelSize = cameraCtx.camera.zoom * pixelsPerPoint / density;
+    if (lensShaderCtx.enable) texelSize *= lensShaderCtx.magnification;
+    return texelSize >= GRID_FADE_START;
+}
+
+void updateCanvasShaderContext(void) {
+    int variant = 0;
+    if (lensShaderCtx.enable) {
+        variant |= CANVAS_SHADER_LENS;
+        if (lensShaderCtx.filter == LENS_FILTER_BICUBIC) variant |= CANVAS_SHADER_BICUBIC;
+    }
+    if (showPixelGrid && isPixelGridVisible()) variant |= CANVAS_SHADER_GRID;
+    canvasShaderCtx.current = variant;
+}
+
+void setCanvasShaderUniformValues(void) {
+    struct CanvasShaderVariant *v = loadCanvasShaderVariant(canvasShaderCtx.current);
+    if (!(canvasShaderCtx.current & CANVAS_SHADER_LENS)) return;
+    SetShaderValue(v->shader, v->lensCenter, lensShaderCtx.center, SHADER_UNIFORM_VEC2);
+    SetShaderValue(v->shader, v->lensRadius, &lensShaderCtx.worldRadius, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(v->shader, v->magnification, &lensShaderCtx.magnification, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(v->shader, v->pixelSize, &lensShaderCtx.pixelSize, SHADER_UNIFORM_FLOAT);
+}
+
+void updateScreenshotTextureFilter(void) {
+    /* bicubic lens relies on hardware bilinear taps, base image is always fetched per texel */
+    int filter = lensShaderCtx.enable && lensShaderCtx.filter == LENS_FILTER_BICUBIC ? TEXTURE_FILTER_BILINEAR : TEXTURE_FILTER_POINT;
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        SetTextureFilter(screenshotTexCtx.screenshots[i].tex, filter);
+    }
+}
+
+void drawScreenshots(void) {
+    /* pixel grid is composited in the same pass as the base image */
+    struct CanvasShaderVariant *v = loadCanvasShaderVariant(canvasShaderCtx.current & CANVAS_SHADER_GRID);
+    BeginShaderMode(v->shader);
+    for (size_t i = 0; i < screenshotTexCtx.length; ++i) {
+        Rectangle rect = getScreenshotWorldRect(i);
+        float texRect[4] = {rect.x, rect.y, rect.width, rect.height};
+        SetShaderValue(v->shader, v->texRect, texRect, SHADER_UNIFORM_VEC4);
+        DrawTexturePro(TEX_OF_SCREENSHOT(i), (Rectangle){0, 0, WIDTH_OF_SCREENSHOT(i), HEIGHT_OF_SCREENSHOT(i)}, rect, (Vector2){0, 0}, 0.0f, WHITE);
+        /* texRect differs per texture, flush before it gets overwritten */
+        rlDrawRenderBatchActive();
+    }
+    EndShaderMode();
+
+    if (canvasShaderCtx.current & CANVAS_SHADER_LENS) drawLens();
+}
+
+/* lens is its own quad sampling every screen below it, so it isn't clipped at monitor edges */
+void drawLens(void) {
+    if (screenshotTexCtx.length == 0) return;
+    struct CanvasShaderVariant *v = loadCanvasShaderVariant(canvasShaderCtx.current);
+    float radius = lensShaderCtx.worldRadius;
+    float sourceRadius = radius / lensShaderCtx.magnification;
+    Rectangle quad = {lensShaderCtx.center[0] - radius, lensShaderCtx.center[1] - radius, 2.0f * radius, 2.0f * radius};
+    Rectangle source = {lensShaderCtx.center[0] - sourceRadius, lensShaderCtx.center[1] - sourceRadius, 2.0f * sourceRadius, 2.0f * sourceRadius};
+
+    /* only screens the magnified area overlaps, at most one per side & corner in practice */
+    unsigned int textures[LENS_MAX_SCREENS];
+    float screenRects[LENS_MAX_SCREENS * 4];
+    float screenSizes[LENS_MAX_SCREENS * 2];
+    int count = 0;
+    for (size_t i = 0; i < screenshotTexCtx.length && count < LENS_MAX_SCREENS; ++i) {
+        Rectangle rect = getScreenshotWorldRect(i);
+        if (!CheckCollisionRecs(rect, source)) continue;
+        textures[count] = TEX_OF_SCREENSHOT(i).id;
+        screenRects[count * 4 + 0] = rect.x;
+        screenRects[count * 4 + 1] = rect.y;
+        screenRects[count * 4 + 2] = rect.width;
+        screenRects[count * 4 + 3] = rect.height;
+        screenSizes[count * 2 + 0] = (float)WIDTH_OF_SCREENSHOT(i);
+        screenSizes[count * 2 + 1] = (float)HEIGHT_OF_SCREENSHOT(i);
+        count++;
+    }
+
+    float texRect[4] = {quad.x, quad.y, quad.width, quad.height};
+    SetShaderValue(v->shader, v->texRect, texRect, SHADER_UNIFORM_VEC4);
+    SetShaderValue(v->shader, v->screenCount, &count, SHADER_UNIFORM_INT);
+    if (count) {
+        SetShaderValueV(v->shader, v->screenRects, screenRects, SHADER_UNIFORM_VEC4, count);
+        SetShaderValueV(v->shader, v->screenSizes, screenSizes, SHADER_UNIFORM_VEC2, count);
+    }
+
+    BeginShaderMode(v->shader);
+    /* raylib only rebinds texture0 per draw call, units after it keep our textures until the flush */
+    for (int i = 0; i < count; ++i) {
+        rlActiveTextureSlot(i + 1);
+        rlEnableTexture(textures[i]);
+    }
+    rlActiveTextureSlot(0);
+    /* texture0 isn't sampled, any texture spans texcoords 0..1 over the quad */
+    DrawTexturePro(TEX_OF_SCREENSHOT(0), (Rectangle){0, 0, WIDTH_OF_SCREENSHOT(0), HEIGHT_OF_SCREENSHOT(0)}, quad, (Vector2){0, 0}, 0.0f, WHITE);
+    rlDrawRenderBatchActive();
+    for (int i = 0; i < count; ++i) {
+        rlActiveTextureSlot(i + 1);
+        rlDisableTexture();
+    }
+    rlActiveTextureSlot(0);
+    EndShaderMode();
+}
+
+/* rulers along top & left edges, labeled in capture pixel coordinates of the screen under cursor */
+void drawRulers(void) {
+    if (screenshotTexCtx.length == 0) return;
+    Camera2D camera = cameraCtx.camera;
+    size_t idx = 0;
+    int px = 0, py = 0;
+    bool inside = getScreenshotPixelAt(inputCtx.mouseWorldPos, &idx, &px, &py);
+    /* world = origin + capture / density, same mapping as pixel inspector */
+    Rectangle rect = getScreenshotWorldRect(idx);
+    float density = SCALE_OF_SCREENSHOT(idx) / worldScale;
+    float originX = rect.x - POSX_OF_SCREENSHOT(idx) / density;
+    float originY = rect.y - POSY_OF_SCREENSHOT(idx) / density;
+
+    /* 1, 2, 5 times a power of ten, the smallest one keeping labels apart */
+    float step = 1.0f;
+    for (int i = 0; step * camera.zoom / density < RULER_TICK_SPACING; ++i) {
+        step *= i % 3 == 1 ? 2.5f : 2.0f;
+    }
+
+    Vector2 topLeft = GetScreenToWorld2D((Vector2){0, 0}, camera);
+    Vector2 bottomRight = GetScreenToWorld2D((Vector2){(float)screenWidth, (float)screenHeight}, camera);
+    Color background = Fade(BLACK, 0.6f);
+    DrawRectangle(0, 0, screenWidth, RULER_THICK, background);
+    DrawRectangle(0, RULER_THICK, RULER_LABEL_WIDTH, screenHeight - RULER_THICK, background);
+
+    for (float c = ceilf((topLeft.x - originX) * density / step) * step; c <= (bottomRight.x - originX) * density; c += step) {
+        float x = GetWorldToScreen2D((Vector2){originX + c / density, 0}, camera).x;
+        if (x < RULER_LABEL_WIDTH) continue;
+        DrawLineV((Vector2){x, RULER_THICK - 6}, (Vector2){x, RULER_THICK}, RAYWHITE);
+        DrawText(TextFormat("%d", (int)c), (int)x + 2, 2, 10, RAYWHITE);
+    }
+    for (float c = ceilf((topLeft.y - originY) * density / step) * step; c <= (bottomRight.y - originY) * density; c += step) {
+        float y = GetWorldToScreen2D((Vector2){0, originY + c / density}, camera).y;
+        if (y < RULER_THICK) continue;
+        DrawLineV((Vector2){RULER_LABEL_WIDTH - 6, y}, (Vector2){RULER_LABEL_WIDTH, y}, RAYWHITE);
+        DrawText(TextFormat("%d", (int)c), 2, (int)y + 2, 10, RAYWHITE);
+    }
+
+    if (!inside) return;
+    /* cursor pixel on both rulers */
+    const char *labelX = TextFormat("%d", POSX_OF_SCREENSHOT(idx) + px);
+    DrawRectangle((int)inputCtx.mousePos.x, 0, MeasureText(labelX, 10) + 4, RULER_THICK, YELLOW);
+    DrawText(labelX, (int)inputCtx.mousePos.x + 2, 5, 10, BLACK);
+    const char *labelY = TextFormat("%d", POSY_OF_SCREENSHOT(idx) + py);
+    DrawRectangle(0, (int)inputCtx.mousePos.y, RULER_LABEL_WIDTH, 14, YELLOW);
+    DrawText(labelY, 2, (int)inputCtx.mousePos.y + 2, 10, BLACK);
 }
 
 void handleInput(void) {
-    if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+    bool panning = IsMouseButtonDown(MOUSE_MIDDLE_BUTTON);
+    if (annotationTool == ANNOTATION_TOOL_NONE) {
+        panning |= IsMouseButtonDown(MOUSE_LEFT_BUTTON);
+    } else {
+        handleAnnotationInput();
+    }
+
+    cameraCtx.dragging = panning;
+    if (panning) {
         Vector2 targetDelta = {inputCtx.mouseDelta.x * (-1.0f / cameraCtx.camera.zoom),
                                inputCtx.mouseDelta.y * (-1.0f / cameraCtx.camera.zoom)};
         cameraCtx.camera.target = Vector2Add(cameraCtx.camera.target, targetDelta);
+
+        /* smoothed drag velocity, carried on as inertia after release */
+        if (frameCtx.deltaTime > 0.0f) {
+            Vector2 sample = Vector2Scale(inputCtx.mouseDelta, 1.0f / frameCtx.deltaTime);
+            float weight = 1.0f - expf(-frameCtx.deltaTime / CAMERA_PAN_SAMPLE_TAU);
+            cameraCtx.panVelocity = Vector2Lerp(cameraCtx.panVelocity, sample, weight);
+        }
     }
 
     if (inputCtx.wheelDelta != 0.0f) {
@@ -285,7 +1304,15 @@ void handleInput(void) {
         float scaleFactor = 1.0f + (0.25f * fabsf(inputCtx.wheelDelta));
         if (inputCtx.wheelDelta < 0) scaleFactor = 1.0f / scaleFactor;
 
-        if (showSpotlight) {
+        if (lensShaderCtx.enable) {
+            if (IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) {
+                /* shift + scroll to change lens radius */
+                lensShaderCtx.radius = Clamp(lensShaderCtx.radius * scaleFactor, LENS_RADIUS_MIN, LENS_RADIUS_MAX);
+            } else {
+                /* scroll to change lens magnification */
+                lensShaderCtx.magnification = Clamp(lensShaderCtx.magnification * scaleFactor, LENS_MAGNIFICATION_MIN, LENS_MAGNIFICATION_MAX);
+            }
+        } else if (showSpotlight) {
             /* scroll to change spotlight radius */
             float radius = splShaderCtx.currentRadius * scaleFactor;
             if (radius >= SPL_RADIUS_MIN && radius <= SPL_RADIUS_MAX) {
@@ -296,7 +1323,8 @@ void handleInput(void) {
             cameraCtx.camera.offset = inputCtx.mousePos;
             cameraCtx.camera.target = inputCtx.mouseWorldPos;
 
-            float zoom = cameraCtx.camera.zoom * scaleFactor;
+            /* successive notches compound while the spring is still moving */
+            float zoom = cameraCtx.targetZoom * scaleFactor;
             if (zoom >= ZOOM_MIN && zoom <= ZOOM_MAX) {
                 cameraCtx.targetZoom = zoom;
             }
@@ -311,6 +1339,76 @@ void handleInput(void) {
         showDebugInfo = !showDebugInfo;
     }
 
+    if (IsKeyPressed(KEY_P)) {
+        endAnnotationStroke();
+        annotationTool = (annotationTool + 1) % ANNOTATION_TOOL_COUNT;
+    }
+
+    if (IsKeyPressed(KEY_U)) {
+        undoAnnotationStroke();
+    }
+
+    if (IsKeyPressed(KEY_C)) {
+        clearAnnotationLayer();
+    }
+
+    if (showSpotlight && IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
+        pinSpotlight();
+    } else if (showInspector && !showSpotlight) {
+        handleInspectorInput();
+    }
+
+    if (IsKeyPressed(KEY_R)) {
+        recaptureScreenshot();
+    }
+
+    if (IsKeyPressed(KEY_I)) {
+        showInspector = !showInspector;
+        if (lowMemory && showInspector) {
+            startScreenshotInspector();
+        } else if (lowMemory) {
+            stopScreenshotInspector();
+        }
+    }
+
+    if (IsKeyPressed(KEY_S)) {
+        splShaderCtx.shape = (splShaderCtx.shape + 1) % SPL_SHAPE_COUNT;
+    }
+
+    if (IsKeyPressed(KEY_X)) {
+        splShaderCtx.pinnedCount = 0;
+    }
+
+    if (IsKeyPressed(KEY_V)) {
+        toggleRecording();
+    }
+
+    if (IsKeyPressed(KEY_LEFT_BRACKET)) {
+        stepScreenshotHistory(1);
+    }
+
+    if (IsKeyPressed(KEY_RIGHT_BRACKET)) {
+        stepScreenshotHistory(-1);
+    }
+
+    if (IsKeyPressed(KEY_M)) {
+        lensShaderCtx.enable = !lensShaderCtx.enable;
+        updateScreenshotTextureFilter();
+    }
+
+    if (IsKeyPressed(KEY_G)) {
+        showPixelGrid = !showPixelGrid;
+    }
+
+    if (IsKeyPressed(KEY_O)) {
+        showRulers = !showRulers;
+    }
+
+    if (IsKeyPressed(KEY_F)) {
+        lensShaderCtx.filter = (lensShaderCtx.filter + 1) % LENS_FILTER_COUNT;
+        updateScreenshotTextureFilter();
+    }
+
     if (IsKeyPressed(KEY_L)) {
         showSpotlight = !showSpotlight;
         if (showSpotlight) {
@@ -322,21 +1420,167 @@ void handleInput(void) {
     }
 }
 
+void handleAnnotationInput(void) {
+    float zoom = cameraCtx.camera.zoom;
+
+    if (annotationTool == ANNOTATION_TOOL_ERASER) {
+        if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+            eraseAnnotationStrokes(inputCtx.mouseWorldPos, ERASER_RADIUS / zoom);
+        }
+        return;
+    }
+
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        /* thickness is kept in world space, so strokes scale with the canvas */
+        beginAnnotationStroke(annotationTool, inputCtx.mouseWorldPos, ANNOTATION_THICK / zoom, ANNOTATION_COLOR);
+    } else if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+        extendAnnotationStroke(inputCtx.mouseWorldPos, 1.0f / zoom);
+    } else if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
+        endAnnotationStroke();
+    }
+}
+
+void handleInspectorInput(void) {
+    /* drag with right mouse button to select a region */
+    if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
+        inputCtx.selecting = true;
+        inputCtx.selectionStart = inputCtx.mouseWorldPos;
+    }
+    if (inputCtx.selecting) {
+        Vector2 a = inputCtx.selectionStart, b = inputCtx.mouseWorldPos;
+        inputCtx.selection = (Rectangle){fminf(a.x, b.x), fminf(a.y, b.y), fabsf(b.x - a.x), fabsf(b.y - a.y)};
+        if (IsMouseButtonReleased(MOUSE_RIGHT_BUTTON)) inputCtx.selecting = false;
+    }
+}
+
+void drawPixelInspector(void) {
+    size_t idx;
+    int px, py;
+    Color color;
+    if (!getScreenshotPixelAt(inputCtx.mouseWorldPos, &idx, &px, &py) || !getInspectorPixel(idx, px, py, &color)) {
+        return;
+    }
+
+    /* region is the spotlight bounding box, or the selection */
+    Rectangle region = {0};
+    if (showSpotlight) {
+        Vector2 halfSize = Vector2Scale(getSpotlightHalfSize(splShaderCtx.shape, splShaderCtx.currentRadius), 1.0f / cameraCtx.camera.zoom);
+        region = (Rectangle){inputCtx.mouseWorldPos.x - halfSize.x, inputCtx.mouseWorldPos.y - halfSize.y, halfSize.x * 2.0f, halfSize.y * 2.0f};
+    } else if (inputCtx.selection.width > 0.0f && inputCtx.selection.height > 0.0f) {
+        region = inputCtx.selection;
+        Vector2 topLeft = GetWorldToScreen2D((Vector2){region.x, region.y}, cameraCtx.camera);
+        DrawRectangleLinesEx((Rectangle){topLeft.x, topLeft.y, region.width * cameraCtx.camera.zoom, region.height * cameraCtx.camera.zoom}, 1.0f, YELLOW);
+    }
+    /* convert region to pixel coordinates of the screenshot under cursor */
+    Rectangle rect = getScreenshotWorldRect(idx);
+    float density = SCALE_OF_SCREENSHOT(idx) / worldScale;
+    region = (Rectangle){(region.x - rect.x) * density, (region.y - rect.y) * density, region.width * density, region.height * density};
+
+    InspectorStats stats;
+    bool hasStats = region.width > 0.0f && getInspectorRegionStats(idx, region, &stats);
+
+    int width = 300, height = hasStats ? 110 : 50;
+    int x = (int)inputCtx.mousePos.x + 20, y = (int)inputCtx.mousePos.y + 20;
+    if (x + width > screenWidth) x = (int)inputCtx.mousePos.x - width - 20;
+    if (y + height > screenHeight) y = (int)inputCtx.mousePos.y - height - 20;
+
+    DrawRectangle(x, y, width, height, Fade(DARKGRAY, 0.95f));
+    DrawRectangleLinesEx((Rectangle){x, y, width, height}, 2.0f, BLACK);
+    DrawRectangle(x + 10, y + 10, 30, 30, color);
+    DrawText(TextFormat("(%d, %d)", POSX_OF_SCREENSHOT(idx) + px, POSY_OF_SCREENSHOT(idx) + py), x + 50, y + 5, 20, RAYWHITE);
+    DrawText(TextFormat("#%02X%02X%02X  %d, %d, %d", color.r, color.g, color.b, color.r, color.g, color.b), x + 50, y + 25, 20, RAYWHITE);
+
+    if (hasStats) {
+        DrawRectangle(x + 10, y + 60, 30, 30, stats.average);
+        DrawText(TextFormat("avg #%02X%02X%02X  %zu px", stats.average.r, stats.average.g, stats.average.b, stats.pixelCount), x + 50, y + 55, 20, RAYWHITE);
+        DrawText(TextFormat("luma %.1f", stats.luminance), x + 50, y + 75, 20, RAYWHITE);
+    } else if (getInspectorState() == INSPECTOR_BUILDING) {
+        DrawText("building region stats...", x + 50, y + 45, 10, LIGHTGRAY);
+    } else if (getInspectorState() == INSPECTOR_FAILED) {
+        DrawText("region stats unavailable", x + 50, y + 45, 10, LIGHTGRAY);
+    }
+}
+
+/* start recording to --record path or a timestamped y4m file, or stop */
+void toggleRecording(void) {
+    if (isRecording()) {
+        stopRecording();
+        return;
+    }
+
+    const char *path = recordPath;
+    if (path == NULL) {
+        char stamp[32];
+        time_t now = time(NULL);
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+        path = TextFormat("zoomify-%s.y4m", stamp);
+    }
+    int fps = GetMonitorRefreshRate(GetCurrentMonitor());
+    if (startRecording(path, GetRenderWidth(), GetRenderHeight(), fps > 0 ? fps : RECORD_DEFAULT_FPS)) {
+        TraceLog(LOG_WARNING, "failed to start recording to %s", path);
+    }
+}
+
 void drawDebugInfo(void) {
-    DrawRectangle(10, 30, 500, 120, Fade(GRAY, 0.95f));
-    DrawRectangleLinesEx((Rectangle){10, 30, 500, 120}, 2.0f, BLACK);
+    DrawRectangle(10, 30, 500, 340, Fade(GRAY, 0.95f));
+    DrawRectangleLinesEx((Rectangle){10, 30, 500, 340}, 2.0f, BLACK);
     DrawText(TextFormat("zoom: %f", cameraCtx.camera.zoom), 20, 40, 20, RAYWHITE);
     DrawText(TextFormat("camera offset: (%f, %f)", cameraCtx.camera.offset.x, cameraCtx.camera.offset.y), 20, 60, 20, RAYWHITE);
     DrawText(TextFormat("camera target: (%f, %f)", cameraCtx.camera.target.x, cameraCtx.camera.target.y), 20, 80, 20, RAYWHITE);
     DrawText(TextFormat("mouse position: (%f, %f)", inputCtx.mousePos.x, inputCtx.mousePos.y), 20, 100, 20, RAYWHITE);
     DrawText(TextFormat("mouse world position: (%f, %f)", inputCtx.mouseWorldPos.x, inputCtx.mouseWorldPos.y), 20, 120, 20, RAYWHITE);
+    DrawText(TextFormat("annotation tool: %s", getAnnotationToolName(annotationTool)), 20, 140, 20, RAYWHITE);
+    DrawText(TextFormat("annotation strokes: %zu, vertices: %zu", getAnnotationStrokeCount(), getAnnotationVertexCount()), 20, 160, 20, RAYWHITE);
+    RecorderStats rec = getRecorderStats();
+    DrawText(TextFormat("recording: %s, frames: %zu, dropped: %zu + %zu, write errors: %zu", isRecording() ? "on" : "off", rec.framesWritten, rec.droppedReadback, rec.droppedEncoder, rec.writeErrors), 20, 180, 20, RAYWHITE);
+    DrawText(TextFormat("readback latency: avg %.1f ms, max %.1f ms", rec.avgLatencyMs, rec.maxLatencyMs), 20, 200, 20, RAYWHITE);
+    DrawText(TextFormat("history: %d of %zu%s", getHistoryPosition(), getHistoryCount(), isHistoryRestoring() ? ", restoring" : ""), 20, 220, 20, RAYWHITE);
+
+    /* current / peak MB of each pipeline stage */
+    MemStageStats total = getMemStatTotal();
+    DrawText(TextFormat("memory: peak rss %.1f MB, pipeline %.1f / %.1f MB%s", getPeakRSS() / 1048576.0, total.current / 1048576.0,
+                        total.peak / 1048576.0, lowMemory ? ", low" : ""), 20, 240, 20, RAYWHITE);
+    for (int i = 0; i < MEM_STAGE_COUNT; ++i) {
+        MemStageStats stats = getMemStat(i);
+        DrawText(TextFormat("%s %.1f / %.1f", getMemStageName(i), stats.current / 1048576.0, stats.peak / 1048576.0),
+                 20 + (i % 3) * 160, 265 + (i / 3) * 20, 20, RAYWHITE);
+    }
+    DrawText(TextFormat("camera: %s, zoom velocity %.2f, pan velocity %.0f%s", isCameraSettled() ? "settled" : "moving",
+                        cameraCtx.zoomVelocity, Vector2Length(cameraCtx.panVelocity), frameCtx.waiting ? ", idle" : ""),
+             20, 305, 20, RAYWHITE);
+    int variant = canvasShaderCtx.current;
+    DrawText(TextFormat("canvas shader:%s%s%s%s", variant ? "" : " base", variant & CANVAS_SHADER_LENS ? " lens" : "",
+                        variant & CANVAS_SHADER_GRID ? " grid" : "", variant & CANVAS_SHADER_BICUBIC ? " bicubic" : ""),
+             20, 325, 20, RAYWHITE);
 }
 
 void drawKeystrokeTips(void) {
-    DrawRectangle(screenWidth - 310, 30, 300, 100, Fade(PINK, 0.95f));
-    DrawRectangleLinesEx((Rectangle){screenWidth - 310, 30, 300, 100}, 2.0f, PURPLE);
-    DrawText("esc - quit", screenWidth - 300, 40, 20, RAYWHITE);
-    DrawText("h - toggle keystroke tips", screenWidth - 300, 60, 20, RAYWHITE);
-    DrawText("d - toggle debug info", screenWidth - 300, 80, 20, RAYWHITE);
-    DrawText("l - toggle spotlight", screenWidth - 300, 100, 20, RAYWHITE);
+    static const char *tips[] = {
+        "esc - quit",
+        "h - toggle keystroke tips",
+        "d - toggle debug info",
+        "l - toggle spotlight",
+        "s - switch spotlight shape",
+        "right click - pin spotlight",
+        "x - clear pinned spotlights",
+        "m - toggle magnifier lens",
+        "f - switch lens filter",
+        "g - toggle pixel grid",
+        "o - toggle rulers",
+        "i - toggle pixel inspector",
+        "r - recapture screen",
+        "p - switch annotation tool",
+        "u - undo annotation",
+        "c - clear annotations",
+        "v - toggle session recording",
+        "[ / ] - older / newer snapshot",
+    };
+    int count = sizeof(tips) / sizeof(tips[0]);
+    int height = count * 20 + 20;
+
+    DrawRectangle(screenWidth - 310, 30, 300, height, Fade(PINK, 0.95f));
+    DrawRectangleLinesEx((Rectangle){screenWidth - 310, 30, 300, height}, 2.0f, PURPLE);
+    for (int i = 0; i < count; ++i) {
+        DrawText(tips[i], screenWidth - 300, 40 + i * 20, 20, RAYWHITE);
+    }
 }